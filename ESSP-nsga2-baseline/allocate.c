@@ -8,91 +8,237 @@
 # include "rand.h"
 
 extern problem_instance *pi; // Global problem instance
-/* Function to allocate memory to a population */
+/* Layout of the block of one individual inside a population arena:
+   the row pointer tables (seqs, seq_start_days, gene) followed by a data
+   region holding every other buffer, grouped by alignment. The data region
+   has no pointers into the block itself, so copy_ind copies it with one memcpy */
+typedef struct {
+    size_t data_offset;  // Start of the data region in the block
+    size_t data_size;    // Bytes of the data region
+    size_t stride;       // Bytes per individual (multiple of 16)
+} ind_layout;
+
+static ind_layout layout;
+static int layout_ready = 0;
+
+static size_t align_up (size_t n, size_t a)
+{
+    return (n + a - 1) / a * a;
+}
+
+/* Computes the block layout from nreal, nbin, nobj, ncon and the instance size */
+static void compute_layout (void)
+{
+    int ne = pi->num_employees;
+    int h = pi->horizon_length;
+    size_t n = 0;
+    size_t total_bits = 0;
+    int j;
+
+    for (j=0; j<nbin; j++)
+    {
+        total_bits += nbits[j];
+    }
+    n += (size_t)ne * sizeof(seq_id *);
+    n += (size_t)ne * sizeof(int *);
+    n += (size_t)nbin * sizeof(int *);
+    layout.data_offset = align_up(n, 16);
+
+    n = 0;
+    n += (size_t)(nobj + ncon + nbin + ne * ncon + ne) * sizeof(double);
+    n += (size_t)ne * h * sizeof(seq_id);
+    n += ((size_t)ne * h + ne + (size_t)h * pi->num_shifts + total_bits) * sizeof(int);
+    n += (size_t)nreal + (size_t)ne * h + ne;
+    layout.data_size = n;
+    layout.stride = align_up(layout.data_offset + n, 16);
+    layout_ready = 1;
+}
+
+/* Bytes used by each individual of a population arena */
+size_t individual_block_size (void)
+{
+    if (!layout_ready) compute_layout();
+    return layout.stride;
+}
+
+/* Bytes of the data region of an individual (everything copy_ind copies) */
+size_t individual_data_size (void)
+{
+    if (!layout_ready) compute_layout();
+    return layout.data_size;
+}
+
+/* Function to allocate memory to a population: one zeroed arena with a
+   fixed-stride block per individual */
 void allocate_memory_pop (population *pop, int size)
 {
     int i;
+    if (pi == NULL) {
+        fprintf(stderr, "Error: global problem_instance 'pi' is NULL in allocate_memory_pop.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t stride = individual_block_size();
     pop->ind = (individual *)malloc(size*sizeof(individual));
+    pop->arena = (char *)calloc((size_t)size, stride);
+    if (pop->ind == NULL || pop->arena == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for population.\n");
+        exit(EXIT_FAILURE);
+    }
     for (i=0; i<size; i++)
     {
-        allocate_memory_ind (&(pop->ind[i]));
+        allocate_memory_ind (&(pop->ind[i]), pop->arena + (size_t)i * stride);
     }
     return;
 }
 
-/* Function to allocate memory to an individual */
-void allocate_memory_ind (individual *ind)
+/* Function to allocate a population of shells: individuals without storage of
+   their own, which only hold individuals moved in from other populations */
+void allocate_shell_pop (population *pop, int size)
 {
-    int j;
-    if (nreal != 0)
+    pop->ind = (individual *)calloc(size, sizeof(individual));
+    pop->arena = NULL;
+    if (pop->ind == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for population.\n");
+        exit(EXIT_FAILURE);
+    }
+    return;
+}
+
+/* Function to lay out an individual in its (zeroed) arena block.
+   Each employee gets room for horizon_length sequences */
+void allocate_memory_ind (individual *ind, char *block)
+{
+    int ne = pi->num_employees;
+    int h = pi->horizon_length;
+    int e, j;
+
+    if (!layout_ready) compute_layout();
+
+    // Row pointer tables
+    char *p = block;
+    ind->seqs = (seq_id **)p;
+    p += (size_t)ne * sizeof(seq_id *);
+    ind->seq_start_days = (int **)p;
+    p += (size_t)ne * sizeof(int *);
+    ind->gene = (nbin != 0) ? (int **)p : NULL;
+
+    // Data region: doubles, sequence ids and ints, bytes
+    p = block + layout.data_offset;
+    ind->obj = (double *)p;
+    p += nobj * sizeof(double);
+    ind->constr = (ncon != 0) ? (double *)p : NULL;
+    p += ncon * sizeof(double);
+    ind->xbin = (nbin != 0) ? (double *)p : NULL;
+    p += nbin * sizeof(double);
+    ind->emp_constr = (double *)p;
+    p += (size_t)ne * ncon * sizeof(double);
+    ind->emp_pref = (double *)p;
+    p += ne * sizeof(double);
+    for (e = 0; e < ne; e++)
     {
-        ind->xreal = (int *)malloc(nreal*sizeof(int));
+        ind->seqs[e] = (seq_id *)p;
+        p += h * sizeof(seq_id);
     }
-    if (nbin != 0)
+    for (e = 0; e < ne; e++)
     {
-        ind->xbin = (double *)malloc(nbin*sizeof(double));
-        ind->gene = (int **)malloc(nbin*sizeof(int *));
-        for (j=0; j<nbin; j++)
-        {
-            ind->gene[j] = (int *)malloc(nbits[j]*sizeof(int));
-        }
+        ind->seq_start_days[e] = (int *)p;
+        p += h * sizeof(int);
     }
-    ind->obj = (double *)malloc(nobj*sizeof(double));
-    if (ncon != 0)
+    ind->num_seqs = (int *)p;
+    p += ne * sizeof(int);
+    ind->coverage = (int *)p;
+    p += (size_t)h * pi->num_shifts * sizeof(int);
+    for (j = 0; j < nbin; j++)
     {
-        ind->constr = (double *)malloc(ncon*sizeof(double));
+        ind->gene[j] = (int *)p;
+        p += nbits[j] * sizeof(int);
     }
+    ind->xreal = (nreal != 0) ? (unsigned char *)p : NULL;
+    p += nreal;
+    ind->emp_cover = (unsigned char *)p;
+    p += (size_t)ne * h;
+    ind->emp_dirty = (char *)p;
 
-    // Additional allocations for sequences
-    if (pi == NULL) {
-        fprintf(stderr, "Error: global problem_instance 'pi' is NULL in allocate_memory_ind.\n");
-        exit(EXIT_FAILURE);
-    }
-    ind->num_seqs = (int *)malloc(pi->num_employees * sizeof(int));
-    ind->seq_start_days = (int **)malloc(pi->num_employees * sizeof(int *));
-    for (int e = 0; e < pi->num_employees; e++) {
-        ind->seq_start_days[e] = (int *)malloc(pi->horizon_length * sizeof(int)); // max possible sequences
-    }
-    ind->seqs = (ssequence ***)malloc(pi->num_employees * sizeof(ssequence **));
-    for (int e = 0; e < pi->num_employees; e++) {
-        ind->seqs[e] = (ssequence **)malloc(pi->horizon_length * sizeof(ssequence *)); // max possible sequences
-    }
+    ind->constr_type = NULL;
+    ind->eval_valid = 0;
+    ind->duplicate = 0;
     return;
 }
 
-/* Function to deallocate memory to a population */
+/* Function to deallocate memory to a population. Individuals may have been
+   moved between populations (see merge), so the arena is freed as a whole */
 void deallocate_memory_pop (population *pop, int size)
 {
-    int i;
-    for (i=0; i<size; i++)
-    {
-        deallocate_memory_ind (&(pop->ind[i]));
-    }
+    (void)size;
+    free (pop->arena);
     free (pop->ind);
     return;
 }
 
-/* Function to deallocate memory to an individual */
-void deallocate_memory_ind (individual *ind)
+/* Function to deallocate a population of shells (the individuals are owned elsewhere) */
+void deallocate_shell_pop (population *pop)
 {
-    int j;
-    if (nreal != 0)
+    free (pop->ind);
+    return;
+}
+
+/* Function to allocate the scratch buffers of an evaluation context */
+eval_context *allocate_eval_context (problem_instance *pi)
+{
+    eval_context *ctx = (eval_context *)malloc(sizeof(eval_context));
+    if (ctx == NULL)
     {
-        free(ind->xreal);
+        fprintf(stderr, "Memory allocation failed for evaluation context.\n");
+        exit(EXIT_FAILURE);
     }
-    if (nbin != 0)
+    ctx->shift_count = (int *)malloc(pi->num_shifts * sizeof(int));
+    ctx->cover_col = (unsigned char *)malloc(pi->horizon_length * sizeof(unsigned char));
+    ctx->constr = (double *)malloc((ncon > 0 ? ncon : 1) * sizeof(double));
+    ctx->seq_order = (int *)malloc(pi->horizon_length * sizeof(int));
+    if (!ctx->shift_count || !ctx->cover_col || !ctx->constr || !ctx->seq_order)
     {
-        for (j=0; j<nbin; j++)
-        {
-            free(ind->gene[j]);
-        }
-        free(ind->xbin);
-        free(ind->gene);
+        fprintf(stderr, "Memory allocation failed for evaluation context.\n");
+        exit(EXIT_FAILURE);
     }
-    free(ind->obj);
-    if (ncon != 0)
+
+    // Roster cache, rounded up to a power of two entries (one dummy slot if disabled)
+    roster_cache *cache = &ctx->cache;
+    cache->capacity = 0;
+    if (roster_cache_size > 0)
+    {
+        cache->capacity = 1;
+        while (cache->capacity < roster_cache_size) cache->capacity *= 2;
+    }
+    int slots = (cache->capacity > 0) ? cache->capacity : 1;
+    cache->keys = (uint64_t *)calloc(slots, sizeof(uint64_t));
+    cache->checks = (uint64_t *)malloc(slots * sizeof(uint64_t));
+    cache->constr = (double *)malloc(slots * (ncon > 0 ? ncon : 1) * sizeof(double));
+    cache->pref = (double *)malloc(slots * sizeof(double));
+    cache->cover = (unsigned char *)malloc(slots * pi->horizon_length * sizeof(unsigned char));
+    if (!cache->keys || !cache->checks || !cache->constr || !cache->pref || !cache->cover)
     {
-        free(ind->constr);
+        fprintf(stderr, "Memory allocation failed for roster cache.\n");
+        exit(EXIT_FAILURE);
     }
+    cache->lookups = 0;
+    cache->hits = 0;
+    return (ctx);
+}
+
+/* Function to deallocate an evaluation context */
+void deallocate_eval_context (eval_context *ctx)
+{
+    free(ctx->shift_count);
+    free(ctx->cover_col);
+    free(ctx->constr);
+    free(ctx->seq_order);
+    free(ctx->cache.keys);
+    free(ctx->cache.checks);
+    free(ctx->cache.constr);
+    free(ctx->cache.pref);
+    free(ctx->cache.cover);
+    free(ctx);
     return;
 }
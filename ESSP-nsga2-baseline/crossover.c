@@ -13,6 +13,31 @@ extern double cross2_p;
 
 
 void cross_employee(individual *parent1, individual *parent2,individual *child1, individual *child2,problem_instance *pi);
+
+/* Copies the sequences of parent into child: decode_pop_sequences rebuilds xreal
+   from them, and the child slot otherwise holds a discarded individual */
+static void copy_sequences (individual *parent, individual *child)
+{
+    for (int e = 0; e < pi->num_employees; e++) {
+        int n = parent->num_seqs[e];
+        for (int s = 0; s < n; s++) {
+            child->seqs[e][s] = parent->seqs[e][s];
+            child->seq_start_days[e][s] = parent->seq_start_days[e][s];
+        }
+        child->num_seqs[e] = n;
+    }
+}
+
+/* Makes child an unchanged copy of parent, evaluation cache included */
+static void copy_parent (individual *parent, individual *child)
+{
+    for (int i = 0; i < nreal; i++) {
+        child->xreal[i] = parent->xreal[i];
+    }
+    copy_sequences(parent, child);
+    copy_eval_cache(parent, child);
+}
+
 /* Function to cross two individuals */
 void crossover (individual *parent1, individual *parent2, individual *child1, individual *child2, problem_instance *pi)
 {
@@ -23,10 +48,8 @@ void crossover (individual *parent1, individual *parent2, individual *child1, in
 
         if (total_p == 0) {
             // If both probabilities are 0, just copy parents to children
-            for (int i = 0; i < nreal; i++) {
-                child1->xreal[i] = parent1->xreal[i];
-                child2->xreal[i] = parent2->xreal[i];
-            }
+            copy_parent(parent1, child1);
+            copy_parent(parent2, child2);
             return;
         }
 
@@ -42,10 +65,8 @@ void crossover (individual *parent1, individual *parent2, individual *child1, in
             realcross(parent1, parent2, child1, child2);
         } else {
             // Sin crossover, copiar padres a hijos
-            for (int i = 0; i < nreal; i++) {
-                child1->xreal[i] = parent1->xreal[i];
-                child2->xreal[i] = parent2->xreal[i];
-            }
+            copy_parent(parent1, child1);
+            copy_parent(parent2, child2);
         }
         
     }
@@ -59,7 +80,7 @@ void crossover (individual *parent1, individual *parent2, individual *child1, in
 /* Routine for real variable SBX crossover */
 void realcross (individual *parent1, individual *parent2, individual *child1, individual *child2)
 {
-    int i;
+    int i, j;
     double rand;
     int y1, y2, yl, yu;
     int c1, c2;
@@ -67,8 +88,14 @@ void realcross (individual *parent1, individual *parent2, individual *child1, in
     if (randomperc() <= pcross_real)
     {
         nrealcross++;
-        for (i=0; i<nreal; i++)
+        copy_sequences(parent1, child1);
+        copy_sequences(parent2, child2);
+        invalidate_eval_cache(child1);
+        invalidate_eval_cache(child2);
+        for (j=0; j<nreal; j++)
         {
+            /* Cells are visited in the original day-major order */
+            i = day_major_index(pi, j);
             if (randomperc()<=0.5 )
             {
                 if (fabs(parent1->xreal[i]-parent2->xreal[i]) > EPS)
@@ -142,11 +169,8 @@ void realcross (individual *parent1, individual *parent2, individual *child1, in
     }
     else
     {
-        for (i=0; i<nreal; i++)
-        {
-            child1->xreal[i] = parent1->xreal[i];
-            child2->xreal[i] = parent2->xreal[i];
-        }
+        copy_parent(parent1, child1);
+        copy_parent(parent2, child2);
     }
     return;
 }
@@ -214,6 +238,17 @@ void cross_employee(individual *parent1, individual *parent2,
         child2->num_seqs[e] = 0;
     }
 
+    // Los hijos parten con la evaluación cacheada de su padre; al intercambiar
+    // un empleado se copia también su contribución desde el otro padre. Si uno
+    // de los padres no tiene caché, ninguno de los hijos puede usarla
+    int shared_cache = parent1->eval_valid && parent2->eval_valid;
+    copy_eval_cache(parent1, child1);
+    copy_eval_cache(parent2, child2);
+    if (!shared_cache) {
+        invalidate_eval_cache(child1);
+        invalidate_eval_cache(child2);
+    }
+
     if (rand <= pcross_real)
     {
         // Crossover uniforme a nivel de empleados
@@ -235,6 +270,14 @@ void cross_employee(individual *parent1, individual *parent2,
                 }
             } else {
                 // Padre2 → hijo1, Padre1 → hijo2
+                if (shared_cache) {
+                    set_employee_contribution(child1, pi, e, &parent2->emp_constr[e * ncon], parent2->emp_pref[e],
+                                              &parent2->emp_cover[e * pi->horizon_length]);
+                    set_employee_contribution(child2, pi, e, &parent1->emp_constr[e * ncon], parent1->emp_pref[e],
+                                              &parent1->emp_cover[e * pi->horizon_length]);
+                    child1->emp_dirty[e] = parent2->emp_dirty[e];
+                    child2->emp_dirty[e] = parent1->emp_dirty[e];
+                }
                 for (int s = 0; s < parent2->num_seqs[e]; s++) {
                     child1->seqs[e][child1->num_seqs[e]] = parent2->seqs[e][s];
                     child1->seq_start_days[e][child1->num_seqs[e]] = parent2->seq_start_days[e][s];
@@ -279,6 +322,9 @@ void cross_employee_seqwise(individual *parent1, individual *parent2,
 {
     int num_emps = pi->num_employees;
 
+    invalidate_eval_cache(child1);
+    invalidate_eval_cache(child2);
+
     // Reiniciar secuencias de hijos
     for (int e = 0; e < num_emps; e++) {
         child1->num_seqs[e] = 0;
@@ -47,6 +47,43 @@ void assign_crowding_distance_list (population *pop, list *lst, int front_size)
     return;
 }
 
+/* Routine to compute crowding distance based on objective function values for the individuals listed in members */
+void assign_crowding_distance_array (population *pop, int *members, int front_size)
+{
+    int **obj_array;
+    int *dist;
+    int i, j;
+    if (front_size==1)
+    {
+        pop->ind[members[0]].crowd_dist = INF;
+        return;
+    }
+    if (front_size==2)
+    {
+        pop->ind[members[0]].crowd_dist = INF;
+        pop->ind[members[1]].crowd_dist = INF;
+        return;
+    }
+    obj_array = (int **)malloc(nobj*sizeof(int*));
+    dist = (int *)malloc(front_size*sizeof(int));
+    for (i=0; i<nobj; i++)
+    {
+        obj_array[i] = (int *)malloc(front_size*sizeof(int));
+    }
+    for (j=0; j<front_size; j++)
+    {
+        dist[j] = members[j];
+    }
+    assign_crowding_distance (pop, dist, obj_array, front_size);
+    free (dist);
+    for (i=0; i<nobj; i++)
+    {
+        free (obj_array[i]);
+    }
+    free (obj_array);
+    return;
+}
+
 /* Routine to compute crowding distance based on objective function values when the population in in the form of an array */
 void assign_crowding_distance_indices (population *pop, int c1, int c2)
 {
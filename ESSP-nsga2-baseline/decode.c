@@ -3,13 +3,11 @@
 # include <stdio.h>
 # include <stdlib.h>
 # include <math.h>
+# include <string.h>
 
 # include "global.h"
 # include "rand.h"
 
-extern ssequence ***ssequences_pool_emp; // pools per employee
-extern int *num_sequences_pool_emp;      // number of sequences per employee
-
 /* Function to decode a population to find out the binary variable values based on its bit pattern */
 void decode_pop (population *pop)
 {
@@ -24,10 +22,13 @@ void decode_pop (population *pop)
     return;
 }
 
+static void decode_task(int index, int thread_id, void *arg) {
+    population *pop = (population *)arg;
+    decode_individual_sequences(&(pop->ind[index]), pi);
+}
+
 void decode_pop_sequences(population *pop, problem_instance *pi) {
-    for (int i = 0; i < popsize; i++) {
-        decode_individual_sequences(&(pop->ind[i]), pi);
-    }
+    parallel_for(popsize, decode_task, pop);
 }
 
 /* Function to decode an individual to find out the binary variable values based on its bit pattern */
@@ -59,22 +60,22 @@ void decode_individual_sequences(individual *ind, problem_instance *pi) {
     int num_emps = pi->num_employees;
     int horizon = pi->horizon_length;
 
-    for (int d = 0; d < horizon; d++)
-        for (int e = 0; e < num_emps; e++)
-            ind->xreal[d * num_emps + e] = 0;
+    memset(ind->xreal, 0, num_emps * horizon * sizeof(unsigned char));
 
     for (int e = 0; e < num_emps; e++) {
-        if (!ind->seqs[e] || ind->num_seqs[e] <= 0) continue;
+        if (ind->num_seqs[e] <= 0) continue;
+        unsigned char *row = ind_row(ind, pi, e);
 
         for (int s = 0; s < ind->num_seqs[e]; s++) {
             int start_day = ind->seq_start_days[e][s];
-            ssequence *seq = ind->seqs[e][s];
+            seq_id seq = ind->seqs[e][s];
+            const uint8_t *shifts = seq_shifts(seq);
+            int length = seq_length(seq);
 
-            if (!seq || !seq->shifts) continue;
-            if (start_day < 0 || start_day + seq->length > horizon) continue;
+            if (start_day < 0 || start_day + length > horizon) continue;
 
-            for (int i = 0; i < seq->length; i++)
-                ind->xreal[(start_day + i) * num_emps + e] = seq->shifts[i];
+            for (int i = 0; i < length; i++)
+                row[start_day + i] = shifts[i];
         }
     }
 }
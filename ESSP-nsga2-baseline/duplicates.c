@@ -0,0 +1,142 @@
+/* Detection of genotype duplicates (identical xreal) among parents and children */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# include "global.h"
+
+int demote_duplicates = 0; // If set, fill_nondominated_sort only keeps duplicates to fill the population
+
+/* Hash of the shift matrix of an individual */
+static uint64_t genotype_hash(individual *ind)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    int i = 0;
+    for (; i + 8 <= nreal; i += 8) {
+        uint64_t word;
+        memcpy(&word, &ind->xreal[i], sizeof(uint64_t));
+        h = (h ^ word) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < nreal; i++) {
+        h = (h ^ ind->xreal[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* Open addressing table of individuals by genotype hash */
+typedef struct {
+    int mask;
+    uint64_t *hash;
+    individual **ind;
+    int *id;
+} genotype_table;
+
+static void table_init(genotype_table *t, int n)
+{
+    int size = 1;
+    while (size < 2 * n) size *= 2;
+    t->mask = size - 1;
+    t->hash = (uint64_t *)malloc(size * sizeof(uint64_t));
+    t->ind = (individual **)calloc(size, sizeof(individual *));
+    t->id = (int *)malloc(size * sizeof(int));
+    if (!t->hash || !t->ind || !t->id) {
+        fprintf(stderr, "Memory allocation failed for genotype table.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void table_free(genotype_table *t)
+{
+    free(t->hash);
+    free(t->ind);
+    free(t->id);
+}
+
+/* Returns the id of an individual with the same genotype as ind, or inserts ind with id and returns -1 */
+static int table_find_or_insert(genotype_table *t, individual *ind, int id)
+{
+    uint64_t h = genotype_hash(ind);
+    int slot = (int)(h & t->mask);
+    while (t->ind[slot] != NULL) {
+        if (t->hash[slot] == h && memcmp(t->ind[slot]->xreal, ind->xreal, nreal * sizeof(unsigned char)) == 0) {
+            return t->id[slot];
+        }
+        slot = (slot + 1) & t->mask;
+    }
+    t->hash[slot] = h;
+    t->ind[slot] = ind;
+    t->id[slot] = id;
+    return -1;
+}
+
+/* Copies the evaluation results of src (same genotype) to dst */
+static void copy_evaluation(individual *src, individual *dst)
+{
+    for (int i = 0; i < nobj; i++) dst->obj[i] = src->obj[i];
+    for (int i = 0; i < ncon; i++) dst->constr[i] = src->constr[i];
+    dst->constr_violation = src->constr_violation;
+    copy_eval_cache(src, dst);
+}
+
+typedef struct {
+    population *children;
+    int *source;
+} dedup_job;
+
+static void evaluate_unique_task(int index, int thread_id, void *arg)
+{
+    dedup_job *job = (dedup_job *)arg;
+    if (job->source[index] >= 0) return;
+    evaluate_ind_ctx(&(job->children->ind[index]), pi, thread_eval_ctx[thread_id]);
+}
+
+/* Evaluates the (decoded) child population, skipping children whose genotype
+   equals a parent or an earlier child: those copy the results of the first one.
+   Returns the number of evaluations skipped */
+int evaluate_pop_dedup(population *parents, population *children, problem_instance *pi)
+{
+    genotype_table table;
+    int *source = (int *)malloc(popsize * sizeof(int)); // -1, parent i, or popsize + child i
+    int skipped = 0;
+
+    table_init(&table, 2 * popsize);
+    for (int i = 0; i < popsize; i++) {
+        table_find_or_insert(&table, &parents->ind[i], i);
+    }
+    for (int i = 0; i < popsize; i++) {
+        source[i] = table_find_or_insert(&table, &children->ind[i], popsize + i);
+        if (source[i] >= 0) skipped++;
+    }
+    table_free(&table);
+
+    dedup_job job;
+    job.children = children;
+    job.source = source;
+    parallel_for(popsize, evaluate_unique_task, &job);
+
+    for (int i = 0; i < popsize; i++) {
+        if (source[i] < 0) continue;
+        individual *src = (source[i] < popsize) ? &parents->ind[source[i]] : &children->ind[source[i] - popsize];
+        copy_evaluation(src, &children->ind[i]);
+    }
+    free(source);
+    return skipped;
+}
+
+/* Flags every individual of pop (size n) whose genotype already appeared
+   earlier in pop and returns how many there are */
+int mark_duplicates(population *pop, int n)
+{
+    genotype_table table;
+    int count = 0;
+
+    table_init(&table, n);
+    for (int i = 0; i < n; i++) {
+        pop->ind[i].duplicate = (table_find_or_insert(&table, &pop->ind[i], i) >= 0);
+        count += pop->ind[i].duplicate;
+    }
+    table_free(&table);
+    return count;
+}
@@ -7,21 +7,27 @@
 #include "rand.h"
 #include <unistd.h>
 #include <stdbool.h>
+#include <string.h>
 
 
 int maxprint = 1;
 
+eval_context *default_eval_ctx = NULL; // Context used by the serial callers
+int roster_cache_size = 4096;            // Roster cache entries per evaluation context
+
 extern double *min_realvar;
 extern double *max_realvar;
-/* Routine to evaluate objective function values and constraints for a population */
+static void evaluate_task(int index, int thread_id, void *arg)
+{
+    population *pop = (population *)arg;
+    evaluate_ind_ctx(&(pop->ind[index]), pi, thread_eval_ctx[thread_id]);
+}
+
+/* Routine to evaluate objective function values and constraints for a population.
+   Individuals are independent, so they are spread over the thread pool */
 void evaluate_pop(population *pop, problem_instance *pi)
 {
-    int i;
-    
-    for (i = 0; i < popsize; i++)
-    {
-        evaluate_ind(&(pop->ind[i]), pi);
-    }
+    parallel_for(popsize, evaluate_task, pop);
     return;
 }
 
@@ -48,217 +54,561 @@ void evaluate_pop(population *pop, problem_instance *pi)
     return;
 }*/
 
-/* Routine to evaluate objective function values and constraints for an individual */
-
-void evaluate_ind(individual *ind, problem_instance *pi)
+/* Routine to evaluate the constraints, preference cost and coverage column of a single employee */
+static void evaluate_employee(individual *ind, problem_instance *pi, eval_context *ctx, int employee,
+                              double *constr, double *pref, unsigned char *cover_col)
 {
-    int num_employees = pi->num_employees;
     int horizon_length = pi->horizon_length;
+    unsigned char *row = ind_row(ind, pi, employee);
     int num_shifts = pi->num_shifts;
 
-    ind->constr_violation = 0.0;
-
-    // Create array to store amount of times each restriction is violated
-    ind->constr = (double *)malloc(9*sizeof(double));
-    if (ind->constr == NULL)
+    for (int i = 0; i < ncon; i++)
     {
-        fprintf(stderr, "Memory allocation failed for constraints.\n");
-        exit(EXIT_FAILURE);
-    }
-    // Initialize constraints to 0
-    for (int i = 0; i < 9; i++)
-    {
-        ind->constr[i] = 0.0;
+        constr[i] = 0.0;
     }
+    double obj2 = 0.0;
 
-    // Arrays to store the number of employees assigned to each shift on each day
-    int **shift_coverage = (int **)malloc(horizon_length * sizeof(int *));
-    for (int i = 0; i < horizon_length; i++) {
-        shift_coverage[i] = (int *)calloc(num_shifts, sizeof(int));
-    }
-
-    // Initialize objective values
-    double obj2 = 0.0; // Employee satisfaction (preferences)
-    double obj1 = 0.0; // Shift coverage
-    // sleep(1);
-
-    for (int employee = 0; employee < num_employees; employee++) {
-        int *shift_count = (int *)calloc(num_shifts, sizeof(int));
-        int consecutive_shifts = 0;
-        int consecutive_off = 0;
-        int total_minutes = 0;
-        int weekcount = 0;
-        int consecutive_shifts_for_r4 = 0;
-        
-
-        for (int day = 0; day < horizon_length; day++) {
-            int shift_id = (int)round(ind->xreal[day * num_employees + employee]);
+    int *shift_count = ctx->shift_count;
+    memset(shift_count, 0, num_shifts * sizeof(int));
+    int consecutive_shifts = 0;
+    int consecutive_off = 0;
+    int total_minutes = 0;
+    int weekcount = 0;
+    int consecutive_shifts_for_r4 = 0;
 
-            if (day == 0 && shift_id == 0) {
-                consecutive_shifts = 0;
-                consecutive_off = pi->horizon_length;
-            }else if (day == 0 && shift_id !=0) {
-                consecutive_shifts = pi->horizon_length;
-                consecutive_off=0;
-            }
+    for (int day = 0; day < horizon_length; day++) {
+        int shift_id = row[day];
+        cover_col[day] = 0;
+
+        if (day == 0 && shift_id == 0) {
+            consecutive_shifts = 0;
+            consecutive_off = pi->horizon_length;
+        }else if (day == 0 && shift_id !=0) {
+            consecutive_shifts = pi->horizon_length;
+            consecutive_off=0;
+        }
 
-            // R1: Days off
-            if (shift_id > max_realvar[day * num_employees + employee] ||
-                shift_id < min_realvar[day * num_employees + employee]) {
-                shift_id =0;
-            }
+        // R1: Days off
+        if (is_day_off(pi, employee, day)) {
+            shift_id =0;
+        }
 
-            // R2: max per shift type
-            if (shift_id >= 0 ) {
-                shift_count[shift_id]++;
-                if (shift_count[shift_id] > pi->employees[employee].max_shifts[shift_id]) {
-                    ind->constr_violation -= 1.0;
-                    ind->constr[1] += 1.0;
-                }
+        // R2: max per shift type
+        if (shift_id >= 0 ) {
+            shift_count[shift_id]++;
+            if (shift_count[shift_id] > pi->employees[employee].max_shifts[shift_id]) {
+                constr[1] += 1.0;
             }
+        }
 
-            // R3: incompatible shifts
-            if (day > 0) {
-                int prev_shift = (int)round(ind->xreal[(day - 1) * num_employees + employee]);
-                if (prev_shift >= 0 && shift_id >= 0 && pi->shifts[prev_shift].num_incompatible_shifts > 0) {
-                    for (int j = 0; j < pi->shifts[prev_shift].num_incompatible_shifts; j++) {
-                        if (pi->shifts[prev_shift].incompatible_shifts[j] == shift_id) {
-                            
-                            ind->constr_violation -= 1.0;
-                            ind->constr[2] += 1.0;
-                        }
-                    }
-                }
+        // R3: incompatible shifts
+        if (day > 0) {
+            int prev_shift = row[day - 1];
+            if (shifts_incompatible(pi, prev_shift, shift_id)) {
+                constr[2] += 1.0;
             }
+        }
 
-            // R4: min consecutive shifts
-            if (shift_id == 0 && consecutive_shifts > 0) {
+        // R4: min consecutive shifts
+        if (shift_id == 0 && consecutive_shifts > 0) {
             if (consecutive_shifts < pi->employees[employee].min_consecutive_shifts) {
-               
-                ind->constr_violation -= 1.0;
-                ind->constr[3] += 1.0;
-                }
-                
+                constr[3] += 1.0;
             }
+        }
 
-            // Si hoy es turno y el bloque anterior fue de descanso
-            if (shift_id != 0 && consecutive_off > 0) {
-                if (consecutive_off < pi->employees[employee].min_consecutive_days_off) {
-                    
-                    ind->constr_violation -= 1.0;
-                    ind->constr[3] += 1.0;
-                }
+        // Si hoy es turno y el bloque anterior fue de descanso
+        if (shift_id != 0 && consecutive_off > 0) {
+            if (consecutive_off < pi->employees[employee].min_consecutive_days_off) {
+                constr[3] += 1.0;
             }
+        }
 
-            // Actualiza contadores y chequea R5 (máximo de turnos)
-            if (shift_id != 0) {
-                consecutive_shifts++;
-                consecutive_shifts_for_r4++;
-                consecutive_off = 0;
+        // Actualiza contadores y chequea R5 (máximo de turnos)
+        if (shift_id != 0) {
+            consecutive_shifts++;
+            consecutive_shifts_for_r4++;
+            consecutive_off = 0;
 
-                if (consecutive_shifts_for_r4 > pi->employees[employee].max_consecutive_shifts) {
-                    
-                    ind->constr_violation -= 1.0;
-                    ind->constr[4] += 1.0;
-                }
-            } else {
-                consecutive_off++;
-                consecutive_shifts_for_r4 = 0;
-                consecutive_shifts = 0;
+            if (consecutive_shifts_for_r4 > pi->employees[employee].max_consecutive_shifts) {
+                constr[4] += 1.0;
             }
+        } else {
+            consecutive_off++;
+            consecutive_shifts_for_r4 = 0;
+            consecutive_shifts = 0;
+        }
 
-            // R6: weekends
-            if (day % 7 == 5) {
-                if (shift_id != 0) {
+        // R6: weekends
+        if (day % 7 == 5) {
+            if (shift_id != 0) {
+                weekcount++;
+            } else if (day + 1 < horizon_length) {
+                int next_shift = row[day + 1];
+                if (next_shift != 0) {
                     weekcount++;
-                } else if (day + 1 < horizon_length) {
-                    int next_shift = (int)round(ind->xreal[(day + 1) * num_employees + employee]);
-                    if (next_shift != 0) {
-                        weekcount++;
-                    }
                 }
             }
+        }
 
-            // R7: total minutes
-            if (shift_id >= 0) {
-                total_minutes += pi->shifts[shift_id].length;
-                if (total_minutes > pi->employees[employee].max_total_minutes) {
-                    
-                    ind->constr_violation -= 1.0;
-                    ind->constr[5] += 1.0;
-                }
+        // R7: total minutes
+        if (shift_id >= 0) {
+            total_minutes += pi->shifts[shift_id].length;
+            if (total_minutes > pi->employees[employee].max_total_minutes) {
+                constr[5] += 1.0;
             }
+        }
 
-            // Objective 1: Preferences
-            for (int s = 0; s < num_shifts; s++) {
-                if (s == shift_id) {
-                    obj2 += pi->shift_off_requests[employee][day][s];
-                } else {
-                    obj2 += pi->shift_on_requests[employee][day][s];
-                }
-            }
+        // Objective 1: Preferences
+        obj2 += pref_cost_at(pi, employee, day, shift_id);
 
-            // Coverage tracking
-            if (shift_id > 0 && shift_id < num_shifts) {
-                if (shift_id > max_realvar[day * num_employees + employee] ||
-                    shift_id < min_realvar[day * num_employees + employee]) {
-                    continue;
-                }else{
-                    shift_coverage[day][shift_id]++;
+        // Coverage tracking (days off were already masked by R1)
+        if (shift_id > 0 && shift_id < num_shifts) {
+            cover_col[day] = shift_id;
+        }
+    }
 
-                }   
-            }
+    // R6: max weekends
+    if (weekcount > pi->employees[employee].max_weekends) {
+        constr[6] += 1.0;
+    }
+
+    // R8: min total minutes
+    if (total_minutes < pi->employees[employee].min_total_minutes) {
+        constr[7] += 1.0;
+    }
+
+    *pref = obj2;
+}
+
+/* Number of violations of a running count that reaches n against limit max
+   (the cell evaluator counts one per day the count is above the limit) */
+static inline int count_over_limit(int n, int max)
+{
+    int over = n - (max > 0 ? max : 0);
+    return over > 0 ? over : 0;
+}
+
+static inline int floor_div7(int x)
+{
+    return (x >= 0) ? x / 7 : -((-x + 6) / 7);
+}
+
+/* State of the run-length scan of evaluate_employee_seqs */
+typedef struct {
+    int in_run;         // 0 before day 0, 1 off run, 2 working run
+    int run_len;
+    int run_start;
+    int first_run;      // The first run starts with horizon_length days already counted
+    int prev_shift;     // Shift of the last day scanned
+    int weekcount;
+    double r4, r5;
+} seq_scan;
+
+/* Closes the current run when the next segment is of the other kind
+   (next_is_work 0/1) or at the end of the horizon (-1): R4, R5 and R6 */
+static void scan_close_run(seq_scan *st, problem_instance *pi, int emp_id, int next_is_work)
+{
+    employee *emp = &pi->employees[emp_id];
+    int eff_len = st->run_len + (st->first_run ? pi->horizon_length : 0);
+
+    if (st->in_run == 2) {
+        // R5 is counted per day over the limit, also for the run that ends the horizon
+        st->r5 += count_over_limit(st->run_len, emp->max_consecutive_shifts);
+        // R6: weekends w with day 7w+5 or 7w+6 inside the run
+        int last = st->run_start + st->run_len - 1;
+        int weekends = floor_div7(last - 5) + floor_div7(6 - st->run_start) + 1;
+        if (weekends > 0) st->weekcount += weekends;
+        if (next_is_work == 0 && eff_len < emp->min_consecutive_shifts) st->r4 += 1.0;
+    } else if (st->in_run == 1) {
+        if (next_is_work == 1 && eff_len < emp->min_consecutive_days_off) st->r4 += 1.0;
+    }
+}
+
+/* Starts or extends a run with a segment of len days starting at start */
+static void scan_segment(seq_scan *st, problem_instance *pi, int emp_id, int is_work, int start, int len)
+{
+    int kind = is_work ? 2 : 1;
+    if (st->in_run == kind) {
+        st->run_len += len;
+        return;
+    }
+    if (st->in_run != 0) {
+        scan_close_run(st, pi, emp_id, is_work);
+        st->first_run = 0;
+    }
+    st->in_run = kind;
+    st->run_len = len;
+    st->run_start = start;
+}
+
+/* Same result as evaluate_employee, computed from the placed sequences and their
+   precomputed summaries, so the cost grows with the worked days instead of the
+   horizon. Returns false (without writing anything) when the placement is not a
+   plain roster: sequences overlapping, out of the horizon or on a day off */
+static bool evaluate_employee_seqs(individual *ind, problem_instance *pi, eval_context *ctx, int emp_id,
+                                   double *constr, double *pref, unsigned char *cover_col)
+{
+    int horizon_length = pi->horizon_length;
+    int num_shifts = pi->num_shifts;
+    employee *emp = &pi->employees[emp_id];
+    int n = ind->num_seqs[emp_id];
+    int *order = ctx->seq_order;
+    const int *days_off = &pi->days_off_prefix[emp_id * (horizon_length + 1)];
+
+    if (n > horizon_length) return false;
+
+    // Sort by start day (insertion sort, sequences are usually already in order)
+    for (int k = 0; k < n; k++) {
+        seq_id seq = ind->seqs[emp_id][k];
+        int start = ind->seq_start_days[emp_id][k];
+        if (seq >= (seq_id)seq_table.count) return false;
+        int length = seq_length(seq);
+        if (start < 0 || start + length > horizon_length) return false;
+        if (days_off[start + length] != days_off[start]) return false;
+        int j = k;
+        while (j > 0 && ind->seq_start_days[emp_id][order[j - 1]] > start) {
+            order[j] = order[j - 1];
+            j--;
         }
+        order[j] = k;
+    }
+    for (int k = 1; k < n; k++) {
+        int prev = order[k - 1];
+        if (ind->seq_start_days[emp_id][prev] + seq_length(ind->seqs[emp_id][prev]) >
+            ind->seq_start_days[emp_id][order[k]]) return false;
+    }
 
-        // R6: max weekends
-        if (weekcount > pi->employees[employee].max_weekends) {
-            
-            ind->constr_violation -= 1.0;
-            ind->constr[6] += 1.0;
+    for (int i = 0; i < ncon; i++) {
+        constr[i] = 0.0;
+    }
+    int *shift_count = ctx->shift_count;
+    memset(shift_count, 0, num_shifts * sizeof(int));
+    memset(cover_col, 0, horizon_length * sizeof(unsigned char));
+
+    const int *pref_off = &pi->pref_off_prefix[emp_id * (horizon_length + 1)];
+    int off_minutes = pi->shifts[0].length;
+    bool off_off_incompat = shifts_incompatible(pi, 0, 0);
+    int max_minutes = emp->max_total_minutes;
+    long obj2 = 0;
+    int total_minutes = 0;
+    int minutes_cross = (max_minutes < 0) ? 0 : -1;   // First day the running minutes exceed the maximum
+    double r3 = 0.0;
+
+    seq_scan st;
+    st.in_run = 0;
+    st.run_len = 0;
+    st.run_start = 0;
+    st.first_run = 1;
+    st.prev_shift = 0;
+    st.weekcount = 0;
+    st.r4 = 0.0;
+    st.r5 = 0.0;
+
+    int day = 0;
+    for (int k = 0; k <= n; k++) {
+        int seg_start = (k < n) ? ind->seq_start_days[emp_id][order[k]] : horizon_length;
+
+        // Days off between the previous sequence and this one
+        int gap = seg_start - day;
+        if (gap > 0) {
+            if (day > 0 && shifts_incompatible(pi, st.prev_shift, 0)) r3 += 1.0;
+            if (off_off_incompat) r3 += gap - 1;
+            shift_count[0] += gap;
+            if (minutes_cross < 0 && off_minutes > 0 && total_minutes + gap * off_minutes > max_minutes) {
+                minutes_cross = day + (max_minutes - total_minutes) / off_minutes;
+            }
+            total_minutes += gap * off_minutes;
+            obj2 += pref_off[seg_start] - pref_off[day];
+            scan_segment(&st, pi, emp_id, 0, day, gap);
+            st.prev_shift = 0;
+            day = seg_start;
+        }
+        if (k == n) break;
+
+        seq_id seq = ind->seqs[emp_id][order[k]];
+        const uint8_t *shifts = seq_shifts(seq);
+        int length = seq_length(seq);
+        int seq_minutes = seq_total_minutes(seq);
+        if (day > 0 && shifts_incompatible(pi, st.prev_shift, shifts[0])) r3 += 1.0;
+        r3 += seq_table.internal_incompat[seq];
+        const int *counts = seq_shift_counts(seq);
+        for (int s = 1; s < num_shifts; s++) {
+            shift_count[s] += counts[s];
+        }
+        if (minutes_cross < 0 && total_minutes + seq_minutes > max_minutes) {
+            const int *minutes_prefix = seq_minutes_prefix(seq);
+            int i = 0;
+            while (total_minutes + minutes_prefix[i] <= max_minutes) i++;
+            minutes_cross = day + i;
         }
+        total_minutes += seq_minutes;
+        for (int i = 0; i < length; i++) {
+            obj2 += pref_cost_at(pi, emp_id, day + i, shifts[i]);
+            cover_col[day + i] = shifts[i];
+        }
+        scan_segment(&st, pi, emp_id, 1, day, length);
+        st.prev_shift = shifts[length - 1];
+        day += length;
+    }
+    scan_close_run(&st, pi, emp_id, -1);
+
+    for (int s = 0; s < num_shifts; s++) {
+        constr[1] += count_over_limit(shift_count[s], emp->max_shifts[s]);
+    }
+    constr[2] = r3;
+    constr[3] = st.r4;
+    constr[4] = st.r5;
+    if (minutes_cross >= 0) {
+        constr[5] = horizon_length - minutes_cross;
+    }
+    if (st.weekcount > emp->max_weekends) {
+        constr[6] += 1.0;
+    }
+    if (total_minutes < emp->min_total_minutes) {
+        constr[7] += 1.0;
+    }
+
+    *pref = (double)obj2;
+    return true;
+}
+
+static inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Hashes employee emp and its placed sequences (in placement order, since the
+   cell evaluator lets later sequences overwrite earlier ones) into the roster
+   cache key and an independent check value */
+static void roster_key(individual *ind, int emp, uint64_t *key, uint64_t *check)
+{
+    int n = ind->num_seqs[emp];
+    uint64_t h = mix64((uint64_t)emp + 1);
+    uint64_t c = mix64(((uint64_t)emp << 32) ^ (uint64_t)n ^ 0x9e3779b97f4a7c15ULL);
+
+    for (int k = 0; k < n; k++) {
+        uint64_t seq = (uint64_t)ind->seqs[emp][k] + 1;
+        uint64_t start = (uint64_t)(unsigned int)ind->seq_start_days[emp][k];
+        h = mix64(h ^ seq);
+        h = mix64(h ^ start);
+        c = mix64(c + (seq << 1) + start * 0x9e3779b97f4a7c15ULL);
+    }
+    *key = (h != 0) ? h : 1;
+    *check = c;
+}
+
+/* Writes the hit rate and memory of the roster caches of every thread to fpt */
+void report_roster_cache(FILE *fpt)
+{
+    long lookups = 0, hits = 0;
+    long bytes = 0;
+    for (int t = 0; t < num_threads; t++) {
+        roster_cache *cache = &thread_eval_ctx[t]->cache;
+        lookups += cache->lookups;
+        hits += cache->hits;
+        bytes += (long)cache->capacity * (2 * sizeof(uint64_t) + (ncon + 1) * sizeof(double) +
+                                          pi->horizon_length * sizeof(unsigned char));
+    }
+    fprintf(fpt, "\n Roster cache entries per thread = %d", thread_eval_ctx[0]->cache.capacity);
+    fprintf(fpt, "\n Roster cache lookups = %ld, hits = %ld (hit rate %.2f%%)", lookups, hits,
+            lookups > 0 ? 100.0 * hits / lookups : 0.0);
+    fprintf(fpt, "\n Roster cache memory = %.1f KB", bytes / 1024.0);
+}
+
+/* Replaces the coverage column of employee emp, patching the coverage matrix
+   and obj[0] only on the days where it changed */
+static void set_employee_cover(individual *ind, problem_instance *pi, int emp, const unsigned char *cover_col)
+{
+    int horizon_length = pi->horizon_length;
+    int num_shifts = pi->num_shifts;
+    unsigned char *old_col = &ind->emp_cover[emp * horizon_length];
 
-        // R8: min total minutes
-        if (total_minutes < pi->employees[employee].min_total_minutes) {
-            
-            ind->constr_violation -= 1.0;
-            ind->constr[7] += 1.0;
+    for (int day = 0; day < horizon_length; day++) {
+        int old_shift = old_col[day];
+        int new_shift = cover_col[day];
+        if (old_shift == new_shift) continue;
+
+        if (old_shift > 0) {
+            int *actual = &ind->coverage[day * num_shifts + old_shift];
+            ind->obj[0] += cover_change(pi, day, old_shift, *actual, -1);
+            (*actual)--;
         }
+        if (new_shift > 0) {
+            int *actual = &ind->coverage[day * num_shifts + new_shift];
+            ind->obj[0] += cover_change(pi, day, new_shift, *actual, 1);
+            (*actual)++;
+        }
+        old_col[day] = new_shift;
+    }
+}
 
-        free(shift_count);
+/* Replaces the cached contribution of employee emp (see set_employee_cover) */
+void set_employee_contribution(individual *ind, problem_instance *pi, int emp,
+                               double *constr, double pref, unsigned char *cover_col)
+{
+    set_employee_cover(ind, pi, emp, cover_col);
+    for (int i = 0; i < ncon; i++) {
+        ind->emp_constr[emp * ncon + i] = constr[i];
     }
+    ind->emp_pref[emp] = pref;
+}
 
-    // Objective 2: Shift coverage penalties
+/* Brings the coverage column of emp up to date with its sequences, as the
+   evaluation would compute it (later sequences win on overlaps, days off do not
+   cover). Called after every change to the sequences of a cached individual, so
+   its coverage matrix and obj[0] stay live between evaluations; emp is still
+   re-evaluated for its constraints and preferences */
+void refresh_employee_cover(individual *ind, problem_instance *pi, int emp, eval_context *ctx)
+{
+    int horizon_length = pi->horizon_length;
+    unsigned char *cover_col = ctx->cover_col;
+
+    memset(cover_col, 0, horizon_length * sizeof(unsigned char));
+    for (int k = 0; k < ind->num_seqs[emp]; k++) {
+        seq_id seq = ind->seqs[emp][k];
+        int start = ind->seq_start_days[emp][k];
+        int length = seq_length(seq);
+        if (start < 0 || start + length > horizon_length) continue;
+        memcpy(&cover_col[start], seq_shifts(seq), length * sizeof(unsigned char));
+    }
     for (int day = 0; day < horizon_length; day++) {
-        for (int s = 1; s < num_shifts; s++) { // Start from 1 to skip the empty shift
-            int required = pi->cover_requirements[day][s];
-            int actual = shift_coverage[day][s];
-            
-            
-            
-            // Calculate under-cover penalty
-            if (actual < required) {
-                double penalty = (required - actual) * pi->under_cover_weights[day][s];
-                
-                obj1 += penalty;
-            }
-            // Calculate over-cover penalty
-            else if (actual > required) {
-                double penalty = (actual - required) * pi->over_cover_weights[day][s];
-                
-                obj1 += penalty;
+        if (cover_col[day] >= pi->num_shifts || is_day_off(pi, emp, day)) cover_col[day] = 0;
+    }
+    set_employee_cover(ind, pi, emp, cover_col);
+}
+
+/* Rebuilds the coverage of an individual whose cache is not valid from its
+   sequences, leaving every employee dirty */
+void rebuild_coverage(individual *ind, problem_instance *pi, eval_context *ctx)
+{
+    int num_employees = pi->num_employees;
+    int horizon_length = pi->horizon_length;
+    int num_shifts = pi->num_shifts;
+
+    memset(ind->emp_cover, 0, num_employees * horizon_length * sizeof(unsigned char));
+    memset(ind->coverage, 0, horizon_length * num_shifts * sizeof(int));
+    ind->obj[0] = 0.0;
+    for (int day = 0; day < horizon_length; day++) {
+        for (int s = 1; s < num_shifts; s++) {
+            ind->obj[0] += cover_penalty(pi, day, s, 0);
+        }
+    }
+    memset(ind->emp_dirty, 1, num_employees * sizeof(char));
+    for (int employee = 0; employee < num_employees; employee++) {
+        refresh_employee_cover(ind, pi, employee, ctx);
+    }
+    ind->eval_valid = 1;
+}
+
+/* Forces the next evaluation of ind to recompute every employee */
+void invalidate_eval_cache(individual *ind)
+{
+    ind->eval_valid = 0;
+}
+
+/* Copies the evaluation cache (and the coverage objective it backs) from src to dst */
+void copy_eval_cache(individual *src, individual *dst)
+{
+    int num_employees = pi->num_employees;
+    int horizon_length = pi->horizon_length;
+
+    memcpy(dst->emp_constr, src->emp_constr, num_employees * ncon * sizeof(double));
+    memcpy(dst->emp_pref, src->emp_pref, num_employees * sizeof(double));
+    memcpy(dst->emp_cover, src->emp_cover, num_employees * horizon_length * sizeof(unsigned char));
+    memcpy(dst->coverage, src->coverage, horizon_length * pi->num_shifts * sizeof(int));
+    memcpy(dst->emp_dirty, src->emp_dirty, num_employees * sizeof(char));
+    dst->obj[0] = src->obj[0];
+    dst->eval_valid = src->eval_valid;
+}
+
+/* Routine to evaluate objective function values and constraints for an individual */
+void evaluate_ind(individual *ind, problem_instance *pi)
+{
+    evaluate_ind_ctx(ind, pi, default_eval_ctx);
+}
+
+/* Same as evaluate_ind, using the scratch buffers of ctx.
+   Only the employees marked dirty are re-evaluated; the rest reuse their cached
+   contribution and obj[0] is patched from the coverage delta */
+void evaluate_ind_ctx(individual *ind, problem_instance *pi, eval_context *ctx)
+{
+    int num_employees = pi->num_employees;
+    int horizon_length = pi->horizon_length;
+    int num_shifts = pi->num_shifts;
+
+    if (!ind->eval_valid) {
+        // Start from an empty roster: no coverage, every employee dirty
+        memset(ind->emp_cover, 0, num_employees * horizon_length * sizeof(unsigned char));
+        memset(ind->coverage, 0, horizon_length * num_shifts * sizeof(int));
+        ind->obj[0] = 0.0;
+        for (int day = 0; day < horizon_length; day++) {
+            for (int s = 1; s < num_shifts; s++) { // Start from 1 to skip the empty shift
+                ind->obj[0] += cover_penalty(pi, day, s, 0);
             }
         }
+        memset(ind->emp_dirty, 1, num_employees * sizeof(char));
     }
 
-    // Assign objectives to individual
-    ind->obj[0] = obj1; // Employee satisfaction
-    ind->obj[1] = obj2; // Shift coverage
+    double *constr = ctx->constr;
+    unsigned char *cover_col = ctx->cover_col;
+    roster_cache *cache = &ctx->cache;
+    for (int employee = 0; employee < num_employees; employee++) {
+        if (!ind->emp_dirty[employee]) continue;
+        ind->emp_dirty[employee] = 0;
+
+        int slot = -1;
+        uint64_t key, check;
+        if (cache->capacity > 0) {
+            roster_key(ind, employee, &key, &check);
+            slot = key & (cache->capacity - 1);
+            cache->lookups++;
+            if (cache->keys[slot] == key && cache->checks[slot] == check) {
+                cache->hits++;
+                set_employee_contribution(ind, pi, employee, &cache->constr[slot * ncon], cache->pref[slot],
+                                          &cache->cover[slot * horizon_length]);
+                continue;
+            }
+        }
 
-    // Free allocated memory
-    for (int i = 0; i < horizon_length; i++) {
-        free(shift_coverage[i]);
+        double pref;
+        if (evaluate_employee_seqs(ind, pi, ctx, employee, constr, &pref, cover_col)) {
+            // Only plain rosters are cached: their result depends on the sequences alone
+            if (slot >= 0) {
+                cache->keys[slot] = key;
+                cache->checks[slot] = check;
+                memcpy(&cache->constr[slot * ncon], constr, ncon * sizeof(double));
+                cache->pref[slot] = pref;
+                memcpy(&cache->cover[slot * horizon_length], cover_col, horizon_length * sizeof(unsigned char));
+            }
+        } else {
+            evaluate_employee(ind, pi, ctx, employee, constr, &pref, cover_col);
+        }
+        set_employee_contribution(ind, pi, employee, constr, pref, cover_col);
     }
-    free(shift_coverage);
+    ind->eval_valid = 1;
+
+    // Add up the cached contributions
+    double obj2 = 0.0; // Employee satisfaction (preferences)
+    for (int i = 0; i < ncon; i++)
+    {
+        ind->constr[i] = 0.0;
+    }
+    ind->constr_violation = 0.0;
+    for (int employee = 0; employee < num_employees; employee++) {
+        for (int i = 0; i < ncon; i++) {
+            ind->constr[i] += ind->emp_constr[employee * ncon + i];
+            ind->constr_violation -= ind->emp_constr[employee * ncon + i];
+        }
+        obj2 += ind->emp_pref[employee];
+    }
+
+    // Assign objectives to individual (obj[0], shift coverage, is kept up to date above)
+    ind->obj[1] = obj2; // Employee satisfaction
 }
 
 
@@ -266,16 +616,16 @@ void evaluate_ind(individual *ind, problem_instance *pi)
 // Helper: obtiene el turno de un empleado en un día
 static inline int get_shift_for_day(emp_assign *current_emp, int day) {
     for (int i = 0; i < current_emp->num_seqs; i++) {
-        ssequence *seq = current_emp->seqs[i];
+        seq_id seq = current_emp->seqs[i];
         int start_day = current_emp->seq_start_day[i];
-        if (day >= start_day && day < start_day + seq->length) {
-            return seq->shifts[day - start_day];
+        if (day >= start_day && day < start_day + seq_length_in(current_emp->table, seq)) {
+            return seq_shifts_in(current_emp->table, seq)[day - start_day];
         }
     }
     return 0; // descanso por defecto
 }
 
-bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi) {
+bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi, eval_context *ctx) {
     int emp_id = current_emp->emp_id;
     employee *emp = &pi->employees[emp_id];
 
@@ -283,9 +633,8 @@ bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi) {
     int num_shifts = pi->num_shifts;
 
     // Estado acumulado
-    int *shift_count = (int *)malloc(num_shifts * sizeof(int));
-    if (!shift_count) return false;
-    for (int i = 0; i < num_shifts; i++) shift_count[i] = 0;
+    int *shift_count = ctx->shift_count;
+    memset(shift_count, 0, num_shifts * sizeof(int));
 
     int total_minutes = 0;
     int consecutive_shifts = 0;
@@ -297,17 +646,14 @@ bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi) {
         int shift_id = get_shift_for_day(current_emp, day);
 
         // R1: días libres específicos
-        for (int j = 0; j < emp->num_days_off; j++) {
-            if (emp->days_off[j] == day && shift_id != 0) {
-                shift_id = 0;
-            }
+        if (is_day_off(pi, emp_id, day)) {
+            shift_id = 0;
         }
 
         // R2: máximo por tipo de turno
         if (shift_id > 0 && shift_id < num_shifts) {
             shift_count[shift_id]++;
             if (shift_count[shift_id] > emp->max_shifts[shift_id]) {
-                free(shift_count);
                 return false;
             }
         }
@@ -315,13 +661,8 @@ bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi) {
         // R3: incompatibilidades
         if (day > 0) {
             int prev_shift = get_shift_for_day(current_emp, day - 1);
-            if (prev_shift > 0) {
-                for (int k = 0; k < pi->shifts[prev_shift].num_incompatible_shifts; k++) {
-                    if (pi->shifts[prev_shift].incompatible_shifts[k] == shift_id) {
-                        free(shift_count);
-                        return false;
-                    }
-                }
+            if (prev_shift > 0 && shifts_incompatible(pi, prev_shift, shift_id)) {
+                return false;
             }
         }
 
@@ -329,20 +670,17 @@ bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi) {
         if (shift_id != 0) {
             if (consecutive_off > 0) {
                 if (consecutive_off < emp->min_consecutive_days_off) {
-                    free(shift_count);
                     return false;
                 }
                 consecutive_off = 0;
             }
             consecutive_shifts++;
             if (consecutive_shifts > emp->max_consecutive_shifts) {
-                free(shift_count);
                 return false;
             }
         } else {
             if (consecutive_shifts > 0) {
                 if (consecutive_shifts < emp->min_consecutive_shifts) {
-                    free(shift_count);
                     return false;
                 }
                 consecutive_shifts = 0;
@@ -364,16 +702,13 @@ bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi) {
 
     // R6: chequeo de fines de semana
     if (weekcount > emp->max_weekends) {
-        free(shift_count);
         return false;
     }
 
     // R7: chequeo minutos totales
     if (total_minutes > emp->max_total_minutes || total_minutes < emp->min_total_minutes) {
-        free(shift_count);
         return false;
     }
 
-    free(shift_count);
     return true;
 }
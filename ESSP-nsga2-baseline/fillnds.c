@@ -7,149 +7,103 @@
 # include "global.h"
 # include "rand.h"
 
-/* Routine to perform non-dominated sorting */
-void fill_nondominated_sort (population *mixed_pop, population *new_pop)
-
+/* Routine to perform non-dominated sorting.
+   Survivors are moved from mixed_pop to new_pop and the rest to spare_pop,
+   which becomes the storage of the next child population */
+void fill_nondominated_sort (population *mixed_pop, population *new_pop, population *spare_pop)
 {
-    int flag;
-    int i, j;
-    int end;
-    int front_size;
-    int archieve_size;
-    int rank=1;
-    list *pool;
-    list *elite;
-    list *temp1, *temp2;
-    pool = (list *)malloc(sizeof(list));
-    elite = (list *)malloc(sizeof(list));
-    front_size = 0;
-    archieve_size=0;
-    pool->index = -1;
-    pool->parent = NULL;
-    pool->child = NULL;
-    elite->index = -1;
-    elite->parent = NULL;
-    elite->child = NULL;
-    temp1 = pool;
-    for (i=0; i<2*popsize; i++)
+    int i, j, f;
+    int n = 2*popsize;
+    int nunique = 0;
+    int nfronts;
+    int archieve_size = 0;
+    int *members = (int *)malloc(n*sizeof(int));
+    int *front_start = (int *)malloc((n+1)*sizeof(int));
+    char *taken = (char *)calloc(n, sizeof(char));
+
+    /* Duplicates (see mark_duplicates) are ranked after all the unique individuals */
+    for (i=0; i<n; i++)
     {
-        insert (temp1,i);
-        temp1 = temp1->child;
+        if (!(demote_duplicates && mixed_pop->ind[i].duplicate))
+        {
+            members[nunique++] = i;
+        }
     }
-    i=0;
-    do
+    nfronts = assign_fronts (mixed_pop, members, nunique, 1, front_start);
+    if (nunique < popsize)
     {
-        temp1 = pool->child;
-        insert (elite, temp1->index);
-        front_size = 1;
-        temp2 = elite->child;
-        temp1 = del (temp1);
-        temp1 = temp1->child;
-        do
+        for (i=0, j=nunique; i<n; i++)
         {
-            temp2 = elite->child;
-            if (temp1==NULL)
+            if (demote_duplicates && mixed_pop->ind[i].duplicate)
             {
-                break;
+                members[j++] = i;
             }
-            do
-            {
-                end = 0;
-                flag = check_dominance (&(mixed_pop->ind[temp1->index]), &(mixed_pop->ind[temp2->index]));
-                if (flag == 1)
-                {
-                    insert (pool, temp2->index);
-                    temp2 = del (temp2);
-                    front_size--;
-                    temp2 = temp2->child;
-                }
-                if (flag == 0)
-                {
-                    temp2 = temp2->child;
-                }
-                if (flag == -1)
-                {
-                    end = 1;
-                }
-            }
-            while (end!=1 && temp2!=NULL);
-            if (flag == 0 || flag == 1)
-            {
-                insert (elite, temp1->index);
-                front_size++;
-                temp1 = del (temp1);
-            }
-            temp1 = temp1->child;
         }
-        while (temp1 != NULL);
-        temp2 = elite->child;
-        j=i;
-        if ( (archieve_size+front_size) <= popsize)
+        int nrest = assign_fronts (mixed_pop, members + nunique, n - nunique, nfronts + 1, front_start + nfronts);
+        for (f=nfronts; f<=nfronts+nrest; f++)
+        {
+            front_start[f] += nunique;
+        }
+        nfronts += nrest;
+    }
+
+    i = 0;
+    for (f=0; f<nfronts && archieve_size<popsize; f++)
+    {
+        int *front = members + front_start[f];
+        int front_size = front_start[f+1] - front_start[f];
+        int rank = mixed_pop->ind[front[0]].rank;
+        if (archieve_size+front_size <= popsize)
         {
-            
-            do
+            for (j=0; j<front_size; j++)
             {
-                copy_ind (&mixed_pop->ind[temp2->index], &new_pop->ind[i]);
+                new_pop->ind[i] = mixed_pop->ind[front[j]];
+                taken[front[j]] = 1;
                 new_pop->ind[i].rank = rank;
-                archieve_size+=1;
-                temp2 = temp2->child;
-                i+=1;
+                i++;
             }
-            while (temp2 != NULL);
-            assign_crowding_distance_indices (new_pop, j, i-1);
-            rank+=1;
+            assign_crowding_distance_indices (new_pop, i-front_size, i-1);
+            archieve_size += front_size;
         }
         else
         {
-            crowding_fill (mixed_pop, new_pop, i, front_size, elite);
-            archieve_size = popsize;
+            crowding_fill (mixed_pop, new_pop, i, front_size, front, taken);
             for (j=i; j<popsize; j++)
             {
                 new_pop->ind[j].rank = rank;
             }
+            archieve_size = popsize;
         }
-        temp2 = elite->child;
-        do
-        {
-            temp2 = del (temp2);
-            temp2 = temp2->child;
-        }
-        while (elite->child !=NULL);
-    }
-    while (archieve_size < popsize);
-    while (pool!=NULL)
-    {
-        temp1 = pool;
-        pool = pool->child;
-        free (temp1);
     }
-    while (elite!=NULL)
+    for (i=0, j=0; i<n; i++)
     {
-        temp1 = elite;
-        elite = elite->child;
-        free (temp1);
+        if (!taken[i])
+        {
+            spare_pop->ind[j++] = mixed_pop->ind[i];
+        }
     }
+    free (members);
+    free (front_start);
+    free (taken);
     return;
 }
 
 /* Routine to fill a population with individuals in the decreasing order of crowding distance */
-void crowding_fill (population *mixed_pop, population *new_pop, int count, int front_size, list *elite)
+void crowding_fill (population *mixed_pop, population *new_pop, int count, int front_size, int *front, char *taken)
 {
     int *dist;
-    list *temp;
     int i, j;
-    assign_crowding_distance_list (mixed_pop, elite->child, front_size);
+    assign_crowding_distance_array (mixed_pop, front, front_size);
     dist = (int *)malloc(front_size*sizeof(int));
-    temp = elite->child;
     for (j=0; j<front_size; j++)
     {
-        dist[j] = temp->index;
-        temp = temp->child;
+        dist[j] = front[j];
     }
     quicksort_dist (mixed_pop, dist, front_size);
     for (i=count, j=front_size-1; i<popsize; i++, j--)
     {
-        copy_ind(&mixed_pop->ind[dist[j]], &new_pop->ind[i]);
+        new_pop->ind[i] = mixed_pop->ind[dist[j]];
+        taken[dist[j]] = 1;
     }
     free (dist);
     return;
@@ -10,37 +10,195 @@
 # define GNUPLOT_COMMAND "gnuplot -persist"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <unistd.h>
 
 
+/* Interned work sequences: every distinct sequence is stored once in seq_table
+   and referenced by a 32-bit id. Sequences are immutable, so their summary
+   (used by the sequence evaluator) is computed when they are interned */
+typedef uint32_t seq_id;
+
 typedef struct{
-    int *shifts;
-    int length;
-    int total_minutes;
+    int count;
+    int capacity;           // Sequences that fit before growing the arrays
+    int shifts_capacity;    // Shift slots that fit before growing shifts/minutes_prefix
+    int num_shifts;
+    int *offset;            // count + 1: sequence id covers shifts[offset[id] .. offset[id+1])
+    uint8_t *shifts;        // Packed shift ids of every sequence
+    int *minutes_prefix;    // Aligned with shifts: minutes of the sequence up to each shift
+    int *shift_counts;      // count x num_shifts: times each shift appears
+    int *internal_incompat; // R3 violations between consecutive shifts of the sequence
+    int hash_mask;
+    int *hash_slots;        // Open addressing table of ids by content (-1 = empty)
+}
+sequence_table;
+
+extern sequence_table seq_table;
+
+/* Accessors on an explicit table (the seq_* ones below read seq_table) */
+static inline const uint8_t *seq_shifts_in (const sequence_table *t, seq_id id)
+{
+    return &t->shifts[t->offset[id]];
+}
+
+static inline int seq_length_in (const sequence_table *t, seq_id id)
+{
+    return t->offset[id + 1] - t->offset[id];
+}
+
+static inline int seq_total_minutes_in (const sequence_table *t, seq_id id)
+{
+    return t->minutes_prefix[t->offset[id + 1] - 1];
+}
+
+static inline const int *seq_shift_counts_in (const sequence_table *t, seq_id id)
+{
+    return &t->shift_counts[(size_t)id * t->num_shifts];
+}
+
+static inline const uint8_t *seq_shifts (seq_id id)
+{
+    return &seq_table.shifts[seq_table.offset[id]];
+}
+
+static inline int seq_length (seq_id id)
+{
+    return seq_table.offset[id + 1] - seq_table.offset[id];
+}
+
+/* minutes_prefix[i] = minutes of shifts[0..i] */
+static inline const int *seq_minutes_prefix (seq_id id)
+{
+    return &seq_table.minutes_prefix[seq_table.offset[id]];
+}
+
+static inline int seq_total_minutes (seq_id id)
+{
+    return seq_table.minutes_prefix[seq_table.offset[id + 1] - 1];
+}
+
+static inline int seq_first_shift (seq_id id)
+{
+    return seq_table.shifts[seq_table.offset[id]];
+}
+
+static inline int seq_last_shift (seq_id id)
+{
+    return seq_table.shifts[seq_table.offset[id + 1] - 1];
+}
+
+static inline const int *seq_shift_counts (seq_id id)
+{
+    return &seq_table.shift_counts[(size_t)id * seq_table.num_shifts];
 }
-ssequence;
 
 typedef struct{
     int emp_id;
-    ssequence** seqs;
+    const sequence_table *table;    // Table the ids in seqs refer to
+    seq_id *seqs;
     int* seq_start_day;
     int num_seqs;
 } emp_assign;
 
+/* Feasible rosters of one employee in compressed sparse row form: roster r
+   places seqs[k] starting at days[k] for k in [start[r], start[r+1]) */
+typedef struct{
+    int count;
+    int capacity;           // Rosters that fit in start
+    int entries_capacity;   // (sequence, day) pairs that fit in seqs/days
+    int *start;             // count + 1
+    seq_id *seqs;
+    uint16_t *days;
+    int full;               // Set when a roster did not fit in roster_pool_max_bytes
+    int mapped;             // Arrays point into the pool cache file (see poolcache.c)
+} roster_pool;
+
+/* Seed of the random streams of the roster search. Fixed, so the pools only
+   depend on the instance and can be cached across runs (see poolcache.c) */
+# define ROSTER_POOL_SEED 0.5
+
+static inline int roster_length (roster_pool *rp, int r)
+{
+    return rp->start[r + 1] - rp->start[r];
+}
+
+struct rand_stream;          // See rand.h
+
+/* Implicit pool of the sequences an employee may work (see seqpool.c): how many
+   there are of each length; seq_unrank builds one from its rank */
+# define SEQ_COUNT_MAX (INT64_C(1) << 62)
+/* Mutations that score every sequence of a length score a random sample of
+   this many when there are more */
+# define SEQ_SCAN_LIMIT 4096
+
 typedef struct {
-    int **by_length;       // by_length[len] = array dinámico de índices a secuencias
-    int *count_by_length;  // cuántas secuencias hay de largo len
-    int *capacity_by_length; // capacidad actual para realloc
-    int max_length;        // largo máximo posible
+    int max_length;          // Largo máximo posible
+    int num_shifts;
+    char *allowed;           // num_shifts: shifts the employee may work
+    int64_t *completions;    // (max_length + 1) x num_shifts: strings that can follow each shift
+    int64_t *count_by_length; // Cuántas secuencias hay de largo len (saturated at SEQ_COUNT_MAX)
+    int64_t total;
+    /* Counts by boundary shifts and minutes, for seq_query_count/seq_query_unrank */
+    int minute_unit;         // gcd of the lengths of the allowed shifts
+    int max_units;           // Minutes of the longest sequence, in minute_unit
+    int *units;              // num_shifts: length of each shift in minute_unit
+    int *follow;             // num_shifts x num_shifts: shifts that may follow each one, in order
+    int *num_follow;         // num_shifts
+    int num_end_masks;       // Distinct sets of shifts a sequence may end with
+    char *end_masks;         // num_end_masks x num_shifts
+    int *end_mask_of;        // num_shifts: end mask used when the next day works shift s (0 = off)
+    int64_t **by_minutes;    // Per end mask (NULL until a query needs it), (max_length + 1) x
+                             // num_shifts x (max_units + 1): strings of r more shifts after s
+                             // with at most m units
 } seq_length_index;
 
-extern seq_length_index *seq_index;
-extern emp_assign **employees_pool;
+/* Sequences of one length that fit between the shifts worked the day before
+   and the day after (0 = day off or horizon edge) within a range of minutes */
+typedef struct {
+    int length;
+    int prev_shift;
+    int next_shift;
+    int min_minutes;
+    int max_minutes;
+} seq_query;
+
+extern seq_length_index **seq_index;   // Per employee (shared by employees with the same contract)
+extern int num_seq_classes;
+extern roster_pool *employees_pool;      // Per employee
+extern long roster_pool_max_bytes;
+extern int roster_pool_target;
+extern double roster_pool_seconds;
+
+/* Counting DP over the rosters of one employee, for drawing them uniformly (see
+   rostersampler.c). T holds, for each day d, weekends w and minute units m used
+   before d, the rosters that go on with a sequence starting on day d or later,
+   each day divided by exp(log_scale[d]) */
+# define ROSTER_SAMPLER_MAX_BYTES (256.0 * 1024 * 1024)
+
+typedef struct {
+    int emp;
+    int horizon;
+    int max_length;
+    int min_run;             // min_consecutive_shifts
+    int gap;                 // Días libres entre dos secuencias (al menos 1)
+    int unit;                // minute_unit of the employee's sequence index
+    int min_units;           // min_total_minutes in units
+    int max_shift_units;
+    int num_w;               // max_weekends + 1
+    int num_m;               // max_total_minutes in units + 1
+    int *pair_start;         // max_length + 2: pairs of each length
+    int *pair_units;         // Minutes (in units) of the sequences of each pair
+    double *pair_count;      // Sequences of that length and minutes
+    int *run_limit;          // horizon + 1: longest sequence that may start each day (R1)
+    double *log_scale;       // horizon + 1
+    double *T;               // horizon x num_w x num_m
+} roster_sampler;
 
 typedef struct {
     int rank;
     double constr_violation;
-    int *xreal;
+    unsigned char *xreal;   // Shift matrix, employee-major (see ind_row), one byte per cell
     int **gene;
     double *xbin;
     double *obj;
@@ -50,16 +208,54 @@ typedef struct {
 
     // New: sequences per employee
     int **seq_start_days;   // For each employee, array of start days for their sequences
-    ssequence ***seqs;      // For each employee, array of pointers to sequences
+    seq_id **seqs;          // For each employee, ids (in seq_table) of its sequences
     int *num_seqs;          // Number of sequences assigned per employee
+
+    // Cached per-employee evaluation, so only changed employees are re-evaluated
+    double *emp_constr;     // num_employees x ncon constraint violation counts
+    double *emp_pref;       // Preference cost (obj[1]) of each employee
+    unsigned char *emp_cover; // num_employees x horizon: shift each employee adds to coverage (0 = none)
+    int *coverage;          // horizon x num_shifts coverage matrix (kept live by the mutations)
+    char *emp_dirty;        // Employees modified since the last evaluation
+    int eval_valid;         // 0 if the cache does not match xreal (forces a full evaluation)
+
+    int duplicate;          // Set by mark_duplicates if an earlier individual has the same xreal
 } individual;
 
 typedef struct
 {
     individual *ind;
+    char *arena;            // Storage of the individuals (NULL for a population of shells)
 }
 population;
 
+/* Direct-mapped cache of evaluated employee rosters, keyed by a hash of the
+   employee and its placed sequences (see roster_key) */
+typedef struct
+{
+    int capacity;               // Entries (power of two), 0 if disabled
+    uint64_t *keys;             // 0 marks an empty slot
+    uint64_t *checks;           // Second hash, compared on lookup to rule out collisions
+    double *constr;             // capacity x ncon
+    double *pref;
+    unsigned char *cover;       // capacity x horizon_length coverage footprint
+    long lookups;
+    long hits;
+}
+roster_cache;
+
+/* Scratch buffers used while evaluating, so evaluate_ind and the feasibility
+   checks do not allocate. Each thread must use its own context */
+typedef struct
+{
+    int *shift_count;           // num_shifts
+    unsigned char *cover_col;   // horizon_length
+    double *constr;             // ncon
+    int *seq_order;             // horizon_length: placed sequences sorted by start day
+    roster_cache cache;
+}
+eval_context;
+
 typedef struct lists
 {
     int index;
@@ -103,8 +299,85 @@ typedef struct {
     int **over_cover_weights;   
     int ***shift_on_requests;   
     int ***shift_off_requests;   
+    int *pref_cost;             // num_employees x horizon x num_shifts: preference cost of assigning a shift
+    uint64_t *incompat_bits;    // num_shifts rows of incompat_words: bit b of row a set if b cannot follow a
+    int incompat_words;
+    uint64_t *days_off_bits;    // num_employees rows of days_off_words: bit d set if d is a day off
+    int days_off_words;
+    int *days_off_prefix;       // num_employees x (horizon + 1): days off before each day
+    int *pref_off_prefix;       // num_employees x (horizon + 1): preference cost of resting before each day
 } problem_instance;
 
+/* Shift ids are stored in one byte per cell */
+# define MAX_SHIFT_TYPES 256
+
+/* Genotype accessors: xreal holds the shift of every (employee, day) cell in
+   employee-major order, so one employee's roster is a contiguous row */
+static inline int cell_index (problem_instance *pi, int emp, int day)
+{
+    return emp * pi->horizon_length + day;
+}
+
+static inline unsigned char *ind_row (individual *ind, problem_instance *pi, int emp)
+{
+    return &ind->xreal[emp * pi->horizon_length];
+}
+
+static inline int get_cell (individual *ind, problem_instance *pi, int emp, int day)
+{
+    return ind->xreal[cell_index(pi, emp, day)];
+}
+
+static inline void set_cell (individual *ind, problem_instance *pi, int emp, int day, int shift_id)
+{
+    ind->xreal[cell_index(pi, emp, day)] = (unsigned char)shift_id;
+}
+
+/* Preference cost (contribution to obj[1]) of giving shift_id to emp on day */
+static inline int pref_cost_at (problem_instance *pi, int emp, int day, int shift_id)
+{
+    return pi->pref_cost[(emp * pi->horizon_length + day) * pi->num_shifts + shift_id];
+}
+
+/* Penalty (contribution to obj[0]) of having actual employees assigned to shift s on day */
+static inline double cover_penalty (problem_instance *pi, int day, int s, int actual)
+{
+    int required = pi->cover_requirements[day][s];
+    if (actual < required) {
+        return (required - actual) * pi->under_cover_weights[day][s];
+    }
+    if (actual > required) {
+        return (actual - required) * pi->over_cover_weights[day][s];
+    }
+    return 0.0;
+}
+
+/* Change of that penalty when one more employee (delta = 1) or one less
+   (delta = -1) works shift s on day */
+static inline double cover_change (problem_instance *pi, int day, int s, int actual, int delta)
+{
+    return cover_penalty(pi, day, s, actual + delta) - cover_penalty(pi, day, s, actual);
+}
+
+/* R3: true if shift next cannot be worked the day after shift prev */
+static inline bool shifts_incompatible (problem_instance *pi, int prev, int next)
+{
+    return (pi->incompat_bits[prev * pi->incompat_words + (next >> 6)] >> (next & 63)) & 1;
+}
+
+/* R1: true if day is one of emp's days off */
+static inline bool is_day_off (problem_instance *pi, int emp, int day)
+{
+    return (pi->days_off_bits[emp * pi->days_off_words + (day >> 6)] >> (day & 63)) & 1;
+}
+
+/* Converts position j of the day-major order (j = day * num_employees + emp)
+   used by the report formats into an xreal index */
+static inline int day_major_index (problem_instance *pi, int j)
+{
+    return cell_index(pi, j % pi->num_employees, j / pi->num_employees);
+}
+
 
 extern int nreal;
 extern int nbin;
@@ -141,6 +414,11 @@ extern int angle1;
 extern int angle2;
 
 extern problem_instance *pi;
+extern eval_context *default_eval_ctx;
+extern int num_threads;
+extern int roster_cache_size;
+extern int demote_duplicates;
+extern eval_context **thread_eval_ctx;
 
 extern double mut1_p;
 extern double mut2_p;
@@ -153,16 +431,19 @@ extern double mutammount;
 extern double cross1_p;
 extern double cross2_p;
 
-extern ssequence ***ssequences_pool_emp;
-extern ssequence **ssequences_pool;
-extern int *num_sequences_pool_emp;
+extern int *num_sequences_pool_emp;  // Per employee: sequences it can work (saturated at INT_MAX)
 
 
 
 void allocate_memory_pop (population *pop, int size);
-void allocate_memory_ind (individual *ind);
+void allocate_memory_ind (individual *ind, char *block);
 void deallocate_memory_pop (population *pop, int size);
-void deallocate_memory_ind (individual *ind);
+void allocate_shell_pop (population *pop, int size);
+void deallocate_shell_pop (population *pop);
+size_t individual_block_size (void);
+size_t individual_data_size (void);
+eval_context *allocate_eval_context (problem_instance *pi);
+void deallocate_eval_context (eval_context *ctx);
 
 double maximum (double a, double b);
 double minimum (double a, double b);
@@ -173,6 +454,7 @@ void bincross (individual *parent1, individual *parent2, individual *child1, ind
 
 void assign_crowding_distance_list (population *pop, list *lst, int front_size);
 void assign_crowding_distance_indices (population *pop, int c1, int c2);
+void assign_crowding_distance_array (population *pop, int *members, int front_size);
 void assign_crowding_distance (population *pop, int *dist, int **obj_array, int front_size);
 
 void decode_pop (population *pop);
@@ -185,9 +467,17 @@ int check_dominance (individual *a, individual *b);
 
 void evaluate_pop (population *pop, problem_instance *pi);
 void evaluate_ind (individual *ind, problem_instance *pi);
-
-void fill_nondominated_sort (population *mixed_pop, population *new_pop);
-void crowding_fill (population *mixed_pop, population *new_pop, int count, int front_size, list *cur);
+void evaluate_ind_ctx (individual *ind, problem_instance *pi, eval_context *ctx);
+void invalidate_eval_cache (individual *ind);
+void copy_eval_cache (individual *src, individual *dst);
+void set_employee_contribution (individual *ind, problem_instance *pi, int emp, double *constr, double pref, unsigned char *cover_col);
+void refresh_employee_cover (individual *ind, problem_instance *pi, int emp, eval_context *ctx);
+void rebuild_coverage (individual *ind, problem_instance *pi, eval_context *ctx);
+void report_roster_cache (FILE *fpt);
+
+void fill_nondominated_sort (population *mixed_pop, population *new_pop, population *spare_pop);
+void crowding_fill (population *mixed_pop, population *new_pop, int count, int front_size, int *front, char *taken);
+int assign_fronts (population *pop, int *members, int n, int first_rank, int *front_start);
 
 void initialize_pop (population *pop, problem_instance *pi);
 void initialize_ind (individual *ind);
@@ -204,7 +494,7 @@ void mutation_add(individual *ind, problem_instance *pi, int emp);
 void bin_mutate_ind (individual *ind);
 void real_mutate_ind (individual *ind, problem_instance *pi);
 
-void test_problem (int *xreal, double *xbin, int **gene, double *obj, double *constr);
+void test_problem (unsigned char *xreal, double *xbin, int **gene, double *obj, double *constr);
 
 void assign_rank_and_crowding_distance (population *new_pop);
 
@@ -217,12 +507,48 @@ void q_sort_front_obj(population *pop, int objcount, int obj_array[], int left,
 void quicksort_dist(population *pop, int *dist, int front_size);
 void q_sort_dist(population *pop, int *dist, int left, int right);
 void decode_individual_sequences(individual *ind, problem_instance *pi);
+
+double wall_seconds (void);
+void threadpool_init(int nthreads, problem_instance *pi);
+void threadpool_destroy(void);
+void parallel_for(int n, void (*fn)(int index, int thread_id, void *arg), void *arg);
+
+int evaluate_pop_dedup(population *parents, population *children, problem_instance *pi);
+int mark_duplicates(population *pop, int n);
 void printIndividual(individual *ind, problem_instance *pi);
 void export_of (population *pop, FILE *fpt);
 void export_pop_full(population *pop, FILE *fpt, problem_instance *pi);
 int readInputFile(const char* filePath, problem_instance *pi);
-
-bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi);
+void buildPreferenceCosts(problem_instance *pi);
+void buildConstraintTables(problem_instance *pi);
+
+bool eval_employee_feasible(emp_assign *current_emp, problem_instance *pi, eval_context *ctx);
+
+seq_id seq_table_intern (sequence_table *t, problem_instance *pi, const int *shifts, int length);
+void build_seq_indexes (problem_instance *pi);
+void free_seq_indexes (void);
+void clear_seq_index (seq_length_index *idx);
+size_t seq_indexes_bytes (void);
+seq_id seq_unrank (sequence_table *t, problem_instance *pi, int emp, int length, int64_t rank);
+int64_t seq_random_rank (seq_length_index *idx, int length, struct rand_stream *rs);
+int64_t seq_random_below (int64_t count, struct rand_stream *rs);
+int64_t seq_query_count (problem_instance *pi, seq_length_index *idx, const seq_query *q);
+seq_id seq_query_unrank (sequence_table *t, problem_instance *pi, int emp, const seq_query *q, int64_t rank);
+void roster_pool_init (roster_pool *rp);
+int roster_pool_add (roster_pool *rp, const seq_id *seqs, const int *days, int n);
+size_t roster_pool_bytes (roster_pool *rp);
+void roster_pool_free (roster_pool *rp);
+int roster_sampler_build (roster_sampler *rs, problem_instance *pi, int emp);
+int roster_sampler_draw (roster_sampler *rs, problem_instance *pi, sequence_table *t,
+                         struct rand_stream *rng, seq_id *seqs, int *days);
+double roster_sampler_log_count (roster_sampler *rs);
+void roster_sampler_free (roster_sampler *rs);
+void pool_cache_configure (const char *dir, const char *instance_path);
+const char *pool_cache_file (void);
+int pool_cache_load (problem_instance *pi);
+void pool_cache_save (problem_instance *pi);
+void pool_cache_release (void);
+void seq_table_free (sequence_table *t);
 
 void selection (population *old_pop, population *new_pop, problem_instance *pi);
 individual* tournament (individual *ind1, individual *ind2);
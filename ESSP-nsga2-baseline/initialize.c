@@ -14,68 +14,83 @@ extern int nreal;
 extern int nbin;
 extern int init_type;
 extern int ls_iters;
-extern int ils_reset; /* lo usaremos como default iterations de ILS si >0 */
+extern int ils_reset; /* ILS: pasos sin mejora antes de volver a la mejor asignación */
 extern int *nbits;
 extern double *min_realvar;
 extern double *max_realvar;
 
-/* Pools globales (se mantienen como antes) */
-ssequence **ssequences_pool;
-ssequence ***ssequences_pool_emp; /* por empleado: ssequences_pool_emp[emp][idx] */
-int *num_sequences_pool_emp;
-seq_length_index *seq_index;
 int count = 0;
 
-/* employees_pool: por empleado, un array dinámico de emp_assign (copias) */
-emp_assign **employees_pool;               /* employees_pool[emp] -> emp_assign[] */
-int *employees_pool_capacity;             /* capacidad por empleado */
-int *count_employees_pool;                /* contadores por empleado */
+
+/* Estado incremental del roster parcial del backtracking */
+typedef struct {
+    int minutes;            // Minutos trabajados
+    int weekends;           // Fines de semana trabajados (R5)
+    int run_length;         // Largo de la racha de trabajo que termina la última secuencia
+    int run_end;            // Día siguiente a esa racha
+} roster_state;
+
+/* Estado de la búsqueda de rosters de un empleado. Cada empleado tiene su propio
+   stream aleatorio (derivado de ROSTER_POOL_SEED) y su propia tabla de secuencias, así
+   que los empleados se procesan en paralelo y el resultado no depende del número
+   de hilos. Las secuencias se pasan a seq_table al terminar, en orden de empleado */
+typedef struct {
+    emp_assign assign;
+    rand_stream rng;
+    sequence_table local;
+    eval_context *ctx;      // Contexto del hilo que procesa al empleado
+    long draws;             // Rosters sorteados, descartados por R2 y repetidos
+    long over_max_shifts;
+    long repeated;
+    int backtracking;       // La tabla del muestreador no cabía: se usó backtracking
+    unsigned char *row;     // horizon: turno de cada día del roster parcial (backtracking)
+    int *shift_count;       // num_shifts: turnos de cada tipo del roster parcial
+    roster_state state;
+    /* Presupuesto (roster_pool_target rosters, roster_pool_seconds segundos) */
+    double deadline;        // wall_seconds() en que se acaba el tiempo (0 = sin límite)
+    int timed_out;
+    double seconds;         // Lo que tardó el pool
+    long nodes;
+    /* Reserva del backtracking: muestra uniforme de roster_pool_target de los
+       found rosters alcanzados, cada uno de hasta horizon secuencias */
+    long found;
+    int *kept_length;
+    seq_id *kept_seqs;
+    int *kept_days;
+} roster_search;
 
 /* Forward de tus funciones existentes */
-void backtrackWorkingSequence_C(problem_instance *pi, employee *emp, int *current, int current_len,
-                                int *shift_count, ssequence ***ssequences_pool, int *num_results, int *pool_size);
 void evaluate_ind(individual *ind, problem_instance *pi); /* ya definida en tu código */
-void init_seq_index_for_employee(int emp, int max_length);
-void add_seq_to_index(int emp, int length, int pool_idx);
-void backtracking_employee_seq(emp_assign *current_emp, int day, int consecutive_shifts, int consecutive_off);
+void backtracking_employee_seq(roster_search *rs, int day);
 
 /* ----------------- Helpers seguros para manipular secuencias en individuo ----------------- */
 
 /* Comprueba si seq puede colocarse en ind para emp comenzando en start_day (sin overlap). */
-int can_place_sequence(individual *ind, problem_instance *pi, int emp, ssequence *seq, int start_day) {
-    if (!ind || !pi || !seq) return 0;
+int can_place_sequence(individual *ind, problem_instance *pi, int emp, seq_id seq, int start_day) {
+    if (!ind || !pi) return 0;
     int horizon = pi->horizon_length;
-    int num_emps = pi->num_employees;
-    if (start_day < 0 || start_day + seq->length > horizon) return 0;
-    for (int i = 0; i < seq->length; i++) {
-        if ((int)round(ind->xreal[(start_day + i) * num_emps + emp]) != 0) return 0; /* overlap */
+    int length = seq_length(seq);
+    if (start_day < 0 || start_day + length > horizon) return 0;
+    unsigned char *row = ind_row(ind, pi, emp);
+    for (int i = 0; i < length; i++) {
+        if (row[start_day + i] != 0) return 0; /* overlap */
     }
     return 1;
 }
 
-/* Coloca seq en ind para emp en start_day y actualiza estructuras (asume espacio en allocated_size). */
-void place_sequence(individual *ind, problem_instance *pi, int emp, ssequence *seq, int start_day, int *allocated_size) {
-    if (!ind || !pi || !seq) return;
-    int num_emps = pi->num_employees;
-    /* Asegura que arrays de secuencias existen */
-    if (ind->seqs[emp] == NULL) {
-        int init = (allocated_size[emp] > 0 ? allocated_size[emp] : 4);
-        ind->seqs[emp] = malloc(init * sizeof(ssequence *));
-        ind->seq_start_days[emp] = malloc(init * sizeof(int));
-        allocated_size[emp] = init;
-    }
-    if (ind->num_seqs[emp] >= allocated_size[emp]) {
-        allocated_size[emp] = allocated_size[emp] > 0 ? allocated_size[emp] * 2 : 4;
-        ind->seqs[emp] = realloc(ind->seqs[emp], allocated_size[emp] * sizeof(ssequence *));
-        ind->seq_start_days[emp] = realloc(ind->seq_start_days[emp], allocated_size[emp] * sizeof(int));
-        if (!ind->seqs[emp] || !ind->seq_start_days[emp]) {
-            fprintf(stderr, "Malloc/realloc falló en place_sequence\n");
-            exit(1);
-        }
+/* Coloca seq en ind para emp en start_day y actualiza estructuras.
+   Los arreglos por empleado tienen capacidad horizon_length (ver allocate_memory_ind) */
+void place_sequence(individual *ind, problem_instance *pi, int emp, seq_id seq, int start_day) {
+    if (!ind || !pi) return;
+    if (ind->num_seqs[emp] >= pi->horizon_length) {
+        fprintf(stderr, "place_sequence: empleado %d sin espacio para más secuencias\n", emp);
+        exit(1);
     }
 
-    for (int i = 0; i < seq->length; i++) {
-        ind->xreal[(start_day + i) * num_emps + emp] = seq->shifts[i];
+    unsigned char *row = ind_row(ind, pi, emp);
+    const uint8_t *shifts = seq_shifts(seq);
+    for (int i = 0; i < seq_length(seq); i++) {
+        row[start_day + i] = shifts[i];
     }
     ind->seqs[emp][ind->num_seqs[emp]] = seq;
     ind->seq_start_days[emp][ind->num_seqs[emp]] = start_day;
@@ -87,11 +102,11 @@ void remove_last_sequence(individual *ind, problem_instance *pi, int emp) {
     if (!ind || !pi) return;
     if (ind->num_seqs[emp] <= 0) return;
     int last = ind->num_seqs[emp] - 1;
-    ssequence *seq = ind->seqs[emp][last];
+    seq_id seq = ind->seqs[emp][last];
     int start = ind->seq_start_days[emp][last];
-    int num_emps = pi->num_employees;
-    for (int i = 0; i < seq->length; i++) {
-        ind->xreal[(start + i) * num_emps + emp] = 0;
+    unsigned char *row = ind_row(ind, pi, emp);
+    for (int i = 0; i < seq_length(seq); i++) {
+        row[start + i] = 0;
     }
     ind->num_seqs[emp]--;
     /* No liberamos seq porque pertenece al pool global */
@@ -99,593 +114,820 @@ void remove_last_sequence(individual *ind, problem_instance *pi, int emp) {
 
 /* ===================== Modularización de generación de secuencias ===================== */
 
-/* Genera (o no) secuencias por empleado.
-   mode == 0 -> usa backtrackWorkingSequence_C (comportamiento previo)
-   mode == 1 -> placeholder: crea pools vacíos (posibilidad de implementar otra fuente)
+/* Prepara el pool implícito de secuencias de cada empleado (ver seqpool.c).
+   mode == 0 -> todas las secuencias de 1..max_consecutive_shifts turnos permitidos
+   mode == 1 -> placeholder: pools vacíos (posibilidad de implementar otra fuente)
 */
 void generate_sequences_for_all(problem_instance *pi, int mode) {
     int num_emps = pi->num_employees;
 
-    /* allocate local pools */
-    ssequence ***local_pools = malloc(num_emps * sizeof(ssequence**));
-    int *num_sequences_emp = malloc(num_emps * sizeof(int));
-    int *pool_size_emp = malloc(num_emps * sizeof(int));
-
-    if (!local_pools || !num_sequences_emp || !pool_size_emp) {
+    num_sequences_pool_emp = malloc(num_emps * sizeof(int));
+    if (!num_sequences_pool_emp) {
         fprintf(stderr, "malloc failed in generate_sequences_for_all\n");
         exit(1);
     }
 
-    /* inicializar estructuras de índices */
-    seq_index = malloc(num_emps * sizeof(seq_length_index));
-    if (!seq_index) { fprintf(stderr, "malloc seq_index failed\n"); exit(1); }
-    for (int e = 0; e < num_emps; e++) {
-        init_seq_index_for_employee(e, pi->employees[e].max_consecutive_shifts);
-    }
+    /* Un índice por firma de contrato, compartido por sus empleados */
+    build_seq_indexes(pi);
+    printf("Sequence pools: %d contract classes for %d employees, %zu bytes of counting tables\n",
+           num_seq_classes, num_emps, seq_indexes_bytes());
 
     for (int e = 0; e < num_emps; e++) {
-        pool_size_emp[e] = 16;
-        local_pools[e] = malloc(pool_size_emp[e] * sizeof(ssequence*));
-        if (!local_pools[e]) { fprintf(stderr,"malloc pool failed\n"); exit(1); }
-        num_sequences_emp[e] = 0;
-    }
+        seq_length_index *idx = seq_index[e];
 
-    if (mode == 0) {
-        /* comportamiento actual: backtrack para cada empleado */
-        for (int e = 0; e < num_emps; e++) {
-            employee *emp = &pi->employees[e];
-            int *current = calloc(pi->horizon_length, sizeof(int));
-            int *shift_count = calloc(pi->num_shifts, sizeof(int));
-            if (!current || !shift_count) { fprintf(stderr,"calloc failed\n"); exit(1); }
-            num_sequences_emp[e] = 0;
-
-            backtrackWorkingSequence_C(pi, emp, current, 0, shift_count,
-                                    &local_pools[e], &num_sequences_emp[e], &pool_size_emp[e]);
-
-            printf("Generated %d sequences for employee %s\n", num_sequences_emp[e], emp->name);
-
-            free(current);
-            free(shift_count);
-        }
-    } else {
-        /* placeholder: no generar secuencias (vacío) */
-        for (int e = 0; e < num_emps; e++) {
-            num_sequences_emp[e] = 0;
+        if (mode != 0) {
+            /* placeholder: no generar secuencias (vacío) */
+            clear_seq_index(idx);
             printf("Placeholder: no sequences generated for employee %s\n", pi->employees[e].name);
-        }
-    }
-
-    /* Copiar a globals (ssequences_pool_emp, num_sequences_pool_emp) */
-    num_sequences_pool_emp = malloc(num_emps * sizeof(int));
-    ssequences_pool_emp = malloc(num_emps * sizeof(ssequence**));
-    if (!num_sequences_pool_emp || !ssequences_pool_emp) { fprintf(stderr,"malloc failed\n"); exit(1); }
-
-    for (int e = 0; e < num_emps; e++) {
-        num_sequences_pool_emp[e] = num_sequences_emp[e];
-        if (num_sequences_emp[e] > 0) {
-            ssequences_pool_emp[e] = malloc(num_sequences_emp[e] * sizeof(ssequence*));
-            if (!ssequences_pool_emp[e]) { fprintf(stderr,"malloc failed\n"); exit(1); }
-            for (int s = 0; s < num_sequences_emp[e]; s++) {
-                ssequences_pool_emp[e][s] = local_pools[e][s];
-                /* NOTE: add_sequence_to_pool ya actualizó seq_index durante generación,
-                   por eso NO volvemos a llamar add_seq_to_index aquí (evitamos duplicados). */
-
-                /* Print sequence for employee */
-                printf("Emp %s: Seq %d (len=%d, min=%d): ", pi->employees[e].name, s, local_pools[e][s]->length, local_pools[e][s]->total_minutes);
-                for (int k = 0; k < local_pools[e][s]->length; k++) {
-                    printf("%d ", local_pools[e][s]->shifts[k]);
-                }
-                printf("\n");
-            }
         } else {
-            ssequences_pool_emp[e] = NULL;
+            printf("Generated %lld sequences for employee %s (by length:", (long long)idx->total, pi->employees[e].name);
+            for (int len = 1; len <= idx->max_length; len++) {
+                printf(" %lld", (long long)idx->count_by_length[len]);
+            }
+            printf(")\n");
         }
+        num_sequences_pool_emp[e] = (idx->total > INT32_MAX) ? INT32_MAX : (int)idx->total;
     }
-
-    /* liberar arrays locales (no las secuencias) */
-    for (int e = 0; e < num_emps; e++) free(local_pools[e]);
-    free(local_pools);
-    free(pool_size_emp);
-    free(num_sequences_emp);
 }
 
-/* ===================== initialize_pop integrado (usa generate_sequences_for_all + ILS) ===================== */
-
-void initialize_pop(population *pop, problem_instance *pi) {
-    printf("Initializing population and generating sequences per employee...\n");
-
-    generate_sequences_for_all(pi, 0); // genera pool de secuencias base (por tipo)
-
-    int num_emps = pi->num_employees;
+/* Hash de un roster (ids de la tabla local y días de inicio), nunca 0 */
+static uint64_t roster_hash(const seq_id *seqs, const int *days, int n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (int k = 0; k < n; k++) {
+        h = (h ^ seqs[k]) * 1099511628211ULL;
+        h = (h ^ (uint64_t)days[k]) * 1099511628211ULL;
+    }
+    return h | 1;
+}
 
-    /* ====== Crear pools de asignaciones factibles por empleado ====== */
-    employees_pool = malloc(num_emps * sizeof(emp_assign*));
-    employees_pool_capacity = malloc(num_emps * sizeof(int));
-    count_employees_pool = calloc(num_emps, sizeof(int));
+/* True si se acabó roster_pool_seconds para el empleado */
+static bool out_of_time(roster_search *rs) {
+    if (rs->deadline > 0 && wall_seconds() > rs->deadline) rs->timed_out = 1;
+    return rs->timed_out;
+}
 
-    if (!employees_pool || !employees_pool_capacity || !count_employees_pool) {
-        fprintf(stderr, "malloc failed for employees_pool structures\n");
+/* Llena el pool del empleado con hasta roster_pool_target rosters distintos
+   sorteados uniformemente. El muestreador no ve R2 (máximo por tipo de turno):
+   los rosters que lo exceden se descartan y se sortea otro */
+static void sample_employee_pool(roster_search *rs, roster_sampler *sampler) {
+    int e = rs->assign.emp_id;
+    employee *emp = &pi->employees[e];
+    roster_pool *rp = &employees_pool[e];
+    int *shift_count = rs->ctx->shift_count;
+    long max_draws = 20L * roster_pool_target + 100;
+    double feasible = exp(roster_sampler_log_count(sampler));   // Rosters sin contar R2
+
+    /* Hashes de los rosters ya guardados (direccionamiento abierto) */
+    size_t slots = 64;
+    while (slots < 2 * (size_t)roster_pool_target) slots *= 2;
+    uint64_t *seen = calloc(slots, sizeof(uint64_t));
+    if (!seen) {
+        fprintf(stderr, "malloc failed for roster hashes (emp %d)\n", e);
         exit(1);
     }
 
-    for (int e = 0; e < num_emps; e++) {
-        employees_pool_capacity[e] = 50000;
-        employees_pool[e] = malloc(employees_pool_capacity[e] * sizeof(emp_assign));
-        if (!employees_pool[e]) {
-            fprintf(stderr, "malloc failed employees_pool[%d]\n", e);
-            exit(1);
+    /* Se para también cuando ya están todos los rosters del empleado */
+    while (rs->draws < max_draws && rp->count < roster_pool_target && !rp->full &&
+           rp->count + 0.5 < feasible && !out_of_time(rs)) {
+        int n = roster_sampler_draw(sampler, pi, &rs->local, &rs->rng,
+                                    rs->assign.seqs, rs->assign.seq_start_day);
+        if (n < 0) break;   // El empleado no tiene rosters factibles
+        rs->draws++;
+
+        memset(shift_count, 0, pi->num_shifts * sizeof(int));
+        for (int k = 0; k < n; k++) {
+            const int *counts = seq_shift_counts_in(&rs->local, rs->assign.seqs[k]);
+            for (int s = 1; s < pi->num_shifts; s++) shift_count[s] += counts[s];
         }
-        count_employees_pool[e] = 0;
+        bool over = false;
+        for (int s = 1; s < pi->num_shifts && !over; s++) over = shift_count[s] > emp->max_shifts[s];
+        if (over) {
+            rs->over_max_shifts++;
+            continue;
+        }
+
+        uint64_t h = roster_hash(rs->assign.seqs, rs->assign.seq_start_day, n);
+        size_t slot = h & (slots - 1);
+        while (seen[slot] != 0 && seen[slot] != h) slot = (slot + 1) & (slots - 1);
+        if (seen[slot] == h) {
+            rs->repeated++;
+            continue;
+        }
+        seen[slot] = h;
+        roster_pool_add(rp, rs->assign.seqs, rs->assign.seq_start_day, n);
     }
-    printf("Empezando a crear\n");
-    for (int e = 0; e < num_emps; e++) {
-        printf("Empleado %d...\n", e);
+    free(seen);
+}
 
-        emp_assign current_emp;
-        current_emp.emp_id = e;
-        current_emp.num_seqs = 0;
-        current_emp.seq_start_day = malloc(pi->horizon_length * sizeof(int));
-        current_emp.seqs = malloc(pi->horizon_length * sizeof(ssequence*));
+/* Tarea de parallel_for: pool de un empleado sobre su propio estado, sorteado con
+   el conteo de rosters (rostersampler.c) o, si su tabla no cabe en
+   ROSTER_SAMPLER_MAX_BYTES, con el backtracking */
+static void build_employee_pool(int e, int thread_id, void *arg) {
+    roster_search *rs = &((roster_search *)arg)[e];
+    double start = wall_seconds();
+
+    rs->ctx = thread_eval_ctx[thread_id];
+    rs->deadline = (roster_pool_seconds > 0) ? start + roster_pool_seconds : 0;
+    stream_init(&rs->rng, derived_seed(ROSTER_POOL_SEED, e));
+    memset(&rs->local, 0, sizeof(rs->local));
+
+    rs->assign.emp_id = e;
+    rs->assign.table = &rs->local;
+    rs->assign.num_seqs = 0;
+    rs->assign.seq_start_day = malloc(pi->horizon_length * sizeof(int));
+    rs->assign.seqs = malloc(pi->horizon_length * sizeof(seq_id));
+    if (!rs->assign.seq_start_day || !rs->assign.seqs) {
+        fprintf(stderr, "malloc failed for current_emp arrays (emp %d)\n", e);
+        exit(1);
+    }
+    for (int i = 0; i < pi->horizon_length; i++) {
+        rs->assign.seq_start_day[i] = -1;
+        rs->assign.seqs[i] = 0;
+    }
 
-        if (!current_emp.seq_start_day || !current_emp.seqs) {
-            fprintf(stderr, "malloc failed for current_emp arrays (emp %d)\n", e);
+    roster_sampler sampler;
+    if (roster_sampler_build(&sampler, pi, e)) {
+        sample_employee_pool(rs, &sampler);
+        roster_sampler_free(&sampler);
+    } else {
+        rs->backtracking = 1;
+        rs->row = calloc(pi->horizon_length, sizeof(unsigned char));
+        rs->shift_count = calloc(pi->num_shifts, sizeof(int));
+        size_t slots = (size_t)roster_pool_target * pi->horizon_length;
+        rs->kept_length = malloc(roster_pool_target * sizeof(int));
+        rs->kept_seqs = malloc(slots * sizeof(seq_id));
+        rs->kept_days = malloc(slots * sizeof(int));
+        if (!rs->row || !rs->shift_count || !rs->kept_length || !rs->kept_seqs || !rs->kept_days) {
+            fprintf(stderr, "malloc failed for roster search state (emp %d)\n", e);
             exit(1);
         }
-
-        for (int i = 0; i < pi->horizon_length; i++) {
-            current_emp.seq_start_day[i] = -1;
-            current_emp.seqs[i] = NULL;
+        memset(&rs->state, 0, sizeof(rs->state));
+        backtracking_employee_seq(rs, 0);
+
+        long kept = (rs->found < roster_pool_target) ? rs->found : roster_pool_target;
+        for (long k = 0; k < kept; k++) {
+            size_t first = (size_t)k * pi->horizon_length;
+            if (!roster_pool_add(&employees_pool[e], &rs->kept_seqs[first], &rs->kept_days[first],
+                                 rs->kept_length[k])) break;
         }
+        free(rs->row);
+        free(rs->shift_count);
+        free(rs->kept_length);
+        free(rs->kept_seqs);
+        free(rs->kept_days);
+    }
+    rs->seconds = wall_seconds() - start;
 
-        printf("Empezando el backtracking\n");
-        backtracking_employee_seq(&current_emp, 0, 0, 0);
-        printf("Terminando el backtracking\n");
+    free(rs->assign.seq_start_day);
+    free(rs->assign.seqs);
+}
 
-        free(current_emp.seq_start_day);
-        free(current_emp.seqs);
+/* Pasa a seq_table las secuencias de la tabla local que usa el pool del empleado
+   (las de rosters descartados no) y traduce sus ids. Se llama en serie y en
+   orden de empleado */
+static void publish_employee_pool(roster_search *rs, roster_pool *rp) {
+    sequence_table *local = &rs->local;
+    seq_id *global_id = malloc((local->count > 0 ? local->count : 1) * sizeof(seq_id));
+    char *published = calloc(local->count > 0 ? local->count : 1, sizeof(char));
+    int *shifts = malloc(pi->horizon_length * sizeof(int));
+    if (!global_id || !published || !shifts) {
+        fprintf(stderr, "malloc failed publishing roster pool\n");
+        exit(1);
+    }
 
-        printf("Listo\n");
+    for (int k = 0; k < rp->start[rp->count]; k++) {
+        seq_id id = rp->seqs[k];
+        if (!published[id]) {
+            const uint8_t *packed = seq_shifts_in(local, id);
+            int length = seq_length_in(local, id);
+            for (int i = 0; i < length; i++) shifts[i] = packed[i];
+            global_id[id] = seq_table_intern(&seq_table, pi, shifts, length);
+            published[id] = 1;
+        }
+        rp->seqs[k] = global_id[id];
     }
 
-    printf("Ya se crearon\n");
-    /* Mostrar resumen */
-    int total_pool_size = 0;
-    for (int e = 0; e < num_emps; e++) total_pool_size += count_employees_pool[e];
-    printf("Total feasible emp_assign found: %d (avg %.1f per employee)\n",
-           total_pool_size, (double)total_pool_size / num_emps);
+    free(global_id);
+    free(published);
+    free(shifts);
+    seq_table_free(local);
+}
 
-    /* ====== Inicializar población ====== */
-    for (int i = 0; i < popsize; i++) {
-        individual *ind = &(pop->ind[i]);
+/* Copia al individuo el roster r del pool del empleado e y marca sus turnos en
+   xreal. Los arreglos por empleado (capacidad horizon_length) vienen de
+   allocate_memory_ind */
+static void assign_pool_roster(individual *ind, int e, int r) {
+    roster_pool *rp = &employees_pool[e];
+    int first = rp->start[r];
+    int n = roster_length(rp, r);
+    unsigned char *row = ind_row(ind, pi, e);
+
+    ind->num_seqs[e] = n;
+    for (int s = 0; s < n; s++) {
+        seq_id seq = rp->seqs[first + s];
+        const uint8_t *shifts = seq_shifts(seq);
+        int start = rp->days[first + s];
+        ind->seqs[e][s] = seq;
+        ind->seq_start_days[e][s] = start;
+        for (int d = 0; d < seq_length(seq); d++) {
+            int day = start + d;
+            if (day >= pi->horizon_length) break;
+            row[day] = shifts[d];
+        }
+    }
+}
 
-        int total_size = pi->horizon_length * pi->num_employees;
-        for (int j = 0; j < total_size; j++) ind->xreal[j] = 0;
+/* Estado de la construcción de un individuo con init_type 1 y 2: el roster del
+   pool elegido para cada empleado y la cobertura que dan entre todos. Cada
+   individuo usa su propio stream, así que se arman en paralelo y el resultado
+   no depende del número de hilos */
+typedef struct {
+    rand_stream rng;
+    int *choice;            // num_employees: roster del pool de cada empleado (-1 si no tiene)
+    int *best_choice;       // ILS: mejor asignación encontrada
+    int *order;             // num_employees: empleados con pool, en orden aleatorio
+    int num_order;
+    int *coverage;          // horizon x num_shifts
+    double *gain;           // horizon x num_shifts: cambio de obj[0] si se suma un turno ahí
+    double cover;           // obj[0] de la asignación
+    double pref;            // obj[1] de la asignación (solo con pool_pref)
+    double cover_weight;    // ILS: pesos de obj[0] y obj[1] en la escalarización,
+    double pref_weight;     // ya divididos por la escala de cada objetivo
+} seed_search;
+
+/* init_type 2: costo de preferencias (obj[1]) de cada roster del pool de cada empleado */
+static double **pool_pref = NULL;
+
+/* Cambio en la penalización de cobertura (obj[0]) si se suma (delta 1) o se quita
+   (delta -1) el roster r del empleado e */
+static double roster_cover_change(seed_search *ss, int e, int r, int delta) {
+    roster_pool *rp = &employees_pool[e];
+    int first = rp->start[r];
+    int n = roster_length(rp, r);
+    int ns = pi->num_shifts;
+    double change = 0;
+
+    for (int s = 0; s < n; s++) {
+        seq_id seq = rp->seqs[first + s];
+        const uint8_t *shifts = seq_shifts(seq);
+        int start = rp->days[first + s];
+        for (int d = 0; d < seq_length(seq); d++) {
+            int day = start + d;
+            if (day >= pi->horizon_length) break;
+            change += cover_change(pi, day, shifts[d], ss->coverage[day * ns + shifts[d]], delta);
+        }
+    }
+    return change;
+}
 
-        ind->seqs = malloc(num_emps * sizeof(ssequence**));
-        ind->seq_start_days = malloc(num_emps * sizeof(int*));
-        ind->num_seqs = malloc(num_emps * sizeof(int));
+/* Suma (delta 1) o quita (delta -1) el roster r del empleado e */
+static void apply_roster(seed_search *ss, int e, int r, int delta) {
+    roster_pool *rp = &employees_pool[e];
+    int first = rp->start[r];
+    int n = roster_length(rp, r);
+    int ns = pi->num_shifts;
+
+    ss->cover += roster_cover_change(ss, e, r, delta);
+    if (pool_pref) ss->pref += delta * pool_pref[e][r];
+    for (int s = 0; s < n; s++) {
+        seq_id seq = rp->seqs[first + s];
+        const uint8_t *shifts = seq_shifts(seq);
+        int start = rp->days[first + s];
+        for (int d = 0; d < seq_length(seq); d++) {
+            int day = start + d;
+            if (day >= pi->horizon_length) break;
+            ss->coverage[day * ns + shifts[d]] += delta;
+        }
+    }
+    ss->choice[e] = (delta > 0) ? r : -1;
+}
 
-        if (!ind->seqs || !ind->seq_start_days || !ind->num_seqs) {
-            fprintf(stderr, "malloc failed for ind arrays\n");
-            exit(1);
+/* Roster del pool de e (que no está en la cobertura) con menor
+   cover_weight * cambio de obj[0] + pref_weight * obj[1]. Los empates se rompen
+   al azar, que es lo que da diversidad a la población */
+static int best_roster(seed_search *ss, int e) {
+    roster_pool *rp = &employees_pool[e];
+    int ns = pi->num_shifts;
+    int best = 0, ties = 0;
+    double best_score = 0;
+
+    /* El cambio de cada celda no depende del roster: se calcula una vez */
+    for (int day = 0; day < pi->horizon_length; day++) {
+        ss->gain[day * ns] = 0;
+        for (int s = 1; s < ns; s++) {
+            ss->gain[day * ns + s] = cover_change(pi, day, s, ss->coverage[day * ns + s], 1);
         }
+    }
 
-        /* ====== Selección aleatoria de asignaciones factibles ====== */
-        for (int e = 0; e < num_emps; e++) {
-            int pool_size = count_employees_pool[e];
-            if (pool_size == 0) {
-                fprintf(stderr, "Warning: no feasible sequences found for employee %d\n", e);
-                ind->seqs[e] = NULL;
-                ind->seq_start_days[e] = NULL;
-                ind->num_seqs[e] = 0;
-                continue;
+    for (int r = 0; r < rp->count; r++) {
+        int first = rp->start[r];
+        double change = 0;
+        for (int k = 0; k < roster_length(rp, r); k++) {
+            seq_id seq = rp->seqs[first + k];
+            const uint8_t *shifts = seq_shifts(seq);
+            const double *gain = &ss->gain[rp->days[first + k] * ns];
+            for (int d = 0; d < seq_length(seq); d++, gain += ns) {
+                change += gain[shifts[d]];
             }
+        }
+        double score = ss->cover_weight * change;
+        if (ss->pref_weight != 0) score += ss->pref_weight * pool_pref[e][r];
+        if (r == 0 || score < best_score) {
+            best = r;
+            best_score = score;
+            ties = 1;
+        } else if (score == best_score && stream_rnd(&ss->rng, 0, ties++) == 0) {
+            best = r;
+        }
+    }
+    return best;
+}
 
-            int r = rand() % pool_size;  // seleccion aleatoria
-            emp_assign *chosen = &employees_pool[e][r];
-
-            ind->num_seqs[e] = chosen->num_seqs;
-            ind->seqs[e] = malloc(chosen->num_seqs * sizeof(ssequence*));
-            ind->seq_start_days[e] = malloc(chosen->num_seqs * sizeof(int));
-
-            for (int s = 0; s < chosen->num_seqs; s++) {
-                ind->seqs[e][s] = chosen->seqs[s];
-                ind->seq_start_days[e][s] = chosen->seq_start_day[s];
-            }
+static double seed_score(seed_search *ss) {
+    return ss->cover_weight * ss->cover + ss->pref_weight * ss->pref;
+}
 
-            /* Marca los turnos en xreal */
-            for (int s = 0; s < chosen->num_seqs; s++) {
-                ssequence *seq = chosen->seqs[s];
-                int start = chosen->seq_start_day[s];
-                for (int d = 0; d < seq->length; d++) {
-                    int day = start + d;
-                    if (day >= pi->horizon_length) break;
-                    ind->xreal[day * num_emps + e] = seq->shifts[d];
-                }
-            }
+static void seed_search_init(seed_search *ss, int i) {
+    int num_emps = pi->num_employees;
+    ss->choice = malloc(num_emps * sizeof(int));
+    ss->best_choice = malloc(num_emps * sizeof(int));
+    ss->order = malloc(num_emps * sizeof(int));
+    ss->coverage = calloc(pi->horizon_length * pi->num_shifts, sizeof(int));
+    ss->gain = malloc(pi->horizon_length * pi->num_shifts * sizeof(double));
+    if (!ss->choice || !ss->best_choice || !ss->order || !ss->coverage || !ss->gain) {
+        fprintf(stderr, "malloc failed for seed construction (individual %d)\n", i);
+        exit(1);
+    }
+    stream_init(&ss->rng, derived_seed(seed, i));
+    ss->num_order = 0;
+    for (int e = 0; e < num_emps; e++) {
+        ss->choice[e] = -1;
+        if (employees_pool[e].count > 0) ss->order[ss->num_order++] = e;
+    }
+    ss->cover = 0;
+    for (int day = 0; day < pi->horizon_length; day++) {
+        for (int s = 1; s < pi->num_shifts; s++) {
+            ss->cover += cover_penalty(pi, day, s, 0);
         }
+    }
+    ss->pref = 0;
+    ss->cover_weight = 1;
+    ss->pref_weight = 0;
+}
 
-        evaluate_ind(ind, pi);
+static void seed_search_free(seed_search *ss) {
+    free(ss->choice);
+    free(ss->best_choice);
+    free(ss->order);
+    free(ss->coverage);
+    free(ss->gain);
+}
 
-        if (i % 10 == 0) printf("Initialization progress: built individual %d\n", i);
+/* Desordena los primeros k de los num_order empleados de ss->order */
+static void shuffle_employees(seed_search *ss, int k) {
+    for (int j = 0; j < k; j++) {
+        int other = stream_rnd(&ss->rng, j, ss->num_order - 1);
+        int tmp = ss->order[j]; ss->order[j] = ss->order[other]; ss->order[other] = tmp;
     }
-
-    printf("Initialization finished (popsize=%d)\n", popsize);
 }
 
-/* ===================== Resto de funciones existentes (backtrackWorkingSequence_C, add_sequence_to_pool, etc)
-   deben seguir en el fichero tal cual las tenías. No las reescribo aquí para no duplicar.
-   Ya dejé generate_sequences_for_all llamando a backtrackWorkingSequence_C cuando mode==0.
-*/
+/* Arma el individuo empleado por empleado, en orden aleatorio, contra la
+   cobertura de los ya asignados: cada empleado recibe su mejor roster según
+   best_roster (con los pesos de init_type 1, el que menos sube o más baja la
+   penalización de sub y sobrecobertura) */
+static void greedy_seed(seed_search *ss) {
+    shuffle_employees(ss, ss->num_order);
+    for (int k = 0; k < ss->num_order; k++) {
+        int e = ss->order[k];
+        apply_roster(ss, e, best_roster(ss, e), 1);
+    }
+}
 
-/* add_sequence_to_pool: asegura pool resizing y actualiza índice por longitud */
-void add_sequence_to_pool(
-    ssequence ***pool,
-    ssequence *seq,
-    int *num_results,
-    int *pool_size,
-    int emp
-) {
-    if (*num_results >= *pool_size) {
-        *pool_size *= 2;
-        *pool = realloc(*pool, (*pool_size) * sizeof(ssequence*));
-        if (!*pool) {
-            fprintf(stderr, "Memory allocation failed for sequence pool!\n");
-            exit(1);
+/* Copia la asignación al individuo y lo evalúa */
+static void write_seed(seed_search *ss, individual *ind, int thread_id) {
+    memset(ind->xreal, 0, nreal * sizeof(unsigned char));
+    for (int e = 0; e < pi->num_employees; e++) {
+        if (ss->choice[e] < 0) {
+            ind->num_seqs[e] = 0;
+            continue;
         }
+        assign_pool_roster(ind, e, ss->choice[e]);
     }
+    evaluate_ind_ctx(ind, pi, thread_eval_ctx[thread_id]);
+}
 
-    (*pool)[*num_results] = seq;
-
-    // --- Actualizar índice por longitud ---
-    int len = seq->length;
-    seq_length_index *idx = &seq_index[emp];
+/* init_type 1 */
+static void greedy_individual(int i, int thread_id, void *arg) {
+    seed_search ss;
+    seed_search_init(&ss, i);
+    greedy_seed(&ss);
+    write_seed(&ss, &((population *)arg)->ind[i], thread_id);
+    seed_search_free(&ss);
+}
 
-    if (idx->capacity_by_length[len] == 0) {
-        idx->capacity_by_length[len] = 16;
-        idx->by_length[len] = malloc(idx->capacity_by_length[len] * sizeof(int));
-    } else if (idx->count_by_length[len] >= idx->capacity_by_length[len]) {
-        idx->capacity_by_length[len] *= 2;
-        idx->by_length[len] = realloc(idx->by_length[len],
-                                      idx->capacity_by_length[len] * sizeof(int));
+/* Block exchange: saca mibe_block_size empleados al azar y los vuelve a poner, uno
+   a uno, con su mejor roster. Se deshace si la escalarización empeora */
+static void block_exchange(seed_search *ss, int *saved) {
+    int k = (mibe_block_size < ss->num_order) ? mibe_block_size : ss->num_order;
+    double before = seed_score(ss);
+
+    shuffle_employees(ss, k);
+    for (int j = 0; j < k; j++) {
+        int e = ss->order[j];
+        saved[j] = ss->choice[e];
+        apply_roster(ss, e, saved[j], -1);
+    }
+    for (int j = 0; j < k; j++) {
+        int e = ss->order[j];
+        apply_roster(ss, e, best_roster(ss, e), 1);
     }
+    if (seed_score(ss) > before) {
+        for (int j = 0; j < k; j++) {
+            int e = ss->order[j];
+            apply_roster(ss, e, ss->choice[e], -1);
+        }
+        for (int j = 0; j < k; j++) apply_roster(ss, ss->order[j], saved[j], 1);
+    }
+}
 
-    idx->by_length[len][idx->count_by_length[len]++] = *num_results;
+/* Block swap (perturbación del ILS): cambia el roster de mibs_block_size empleados
+   al azar por uno cualquiera de su pool */
+static void block_swap(seed_search *ss) {
+    int k = (mibs_block_size < ss->num_order) ? mibs_block_size : ss->num_order;
 
-    (*num_results)++;
+    shuffle_employees(ss, k);
+    for (int j = 0; j < k; j++) {
+        int e = ss->order[j];
+        apply_roster(ss, e, ss->choice[e], -1);
+        apply_roster(ss, e, stream_rnd(&ss->rng, 0, employees_pool[e].count - 1), 1);
+    }
 }
 
-/* backtrackWorkingSequence_C: sin cambios lógicos, solo chequeo de memory */
-void backtrackWorkingSequence_C(
-    problem_instance *pi,
-    employee *emp,
-    int *current,
-    int current_len,
-    int *shift_count,
-    ssequence ***ssequences_pool,
-    int *num_results,
-    int *pool_size
-) {
-    if (emp->max_consecutive_shifts > 0 && current_len > emp->max_consecutive_shifts)
-        return;
-
-    if (current_len>0 &&(emp->max_consecutive_shifts == 0 || current_len <= emp->max_consecutive_shifts)) {
+/* Vuelve a la asignación best_choice */
+static void restore_best(seed_search *ss) {
+    for (int e = 0; e < pi->num_employees; e++) {
+        if (ss->choice[e] == ss->best_choice[e]) continue;
+        apply_roster(ss, e, ss->choice[e], -1);
+        apply_roster(ss, e, ss->best_choice[e], 1);
+    }
+}
 
-        int total_minutes = 0;
-        for (int i = 0; i < current_len; i++) {
-            int s = current[i];
-            if (s > 0 && s < pi->num_shifts)
-                total_minutes += pi->shifts[s].length;
-        }
+/* init_type 2: ILS de ls_iters block exchanges sobre la escalarización del
+   individuo. Tras ils_reset pasos sin mejorar vuelve a la mejor asignación y la
+   perturba con un block swap */
+static void ils_seed(seed_search *ss) {
+    if (ss->num_order == 0) return;
+    int *saved = malloc(ss->num_order * sizeof(int));
+    if (!saved) {
+        fprintf(stderr, "malloc failed for ILS state\n");
+        exit(1);
+    }
 
-        ssequence *seq = malloc(sizeof(ssequence));
-        if (!seq) { fprintf(stderr,"malloc seq failed\n"); exit(1); }
-        seq->length = current_len;
-        seq->total_minutes = total_minutes;
-        if (current_len > 0) {
-            seq->shifts = malloc(sizeof(int) * current_len);
-            if (!seq->shifts) { fprintf(stderr,"malloc seq->shifts failed\n"); exit(1); }
-            memcpy(seq->shifts, current, sizeof(int) * current_len);
-        } else {
-            seq->shifts = NULL;
+    memcpy(ss->best_choice, ss->choice, pi->num_employees * sizeof(int));
+    double best = seed_score(ss);
+    int stall = 0;
+    for (int it = 0; it < ls_iters; it++) {
+        block_exchange(ss, saved);
+        double score = seed_score(ss);
+        if (score < best) {
+            best = score;
+            memcpy(ss->best_choice, ss->choice, pi->num_employees * sizeof(int));
+            stall = 0;
+        } else if (++stall >= ils_reset) {
+            restore_best(ss);
+            block_swap(ss);
+            stall = 0;
         }
-
-        add_sequence_to_pool(ssequences_pool, seq, num_results, pool_size, emp->id);
     }
+    restore_best(ss);
+    free(saved);
+}
 
-    // Try all shifts
-    for (int shift_id = 1; shift_id < pi->num_shifts; shift_id++) {
-        if (emp->max_shifts[shift_id] == 0) {
-            continue;
-        }
+static void roster_pref_task(int e, int thread_id, void *arg) {
+    roster_pool *rp = &employees_pool[e];
+    int horizon = pi->horizon_length;
+    const int *pref_off = &pi->pref_off_prefix[e * (horizon + 1)];
+    double *pref = malloc((rp->count > 0 ? rp->count : 1) * sizeof(double));
+    if (!pref) {
+        fprintf(stderr, "malloc failed for pool preferences (emp %d)\n", e);
+        exit(1);
+    }
 
-        if (current_len > 0) {
-            int prev_shift = current[current_len-1];
-            bool incompatible = false;
-            for (int k = 0; k < pi->shifts[prev_shift].num_incompatible_shifts; k++) {
-                if (pi->shifts[prev_shift].incompatible_shifts[k] == shift_id) {
-                    incompatible = true;
-                    break;
-                }
+    /* Igual que evaluate_employee_seqs: los días libres cuestan pref_off */
+    for (int r = 0; r < rp->count; r++) {
+        int first = rp->start[r];
+        long total = pref_off[horizon];
+        for (int s = 0; s < roster_length(rp, r); s++) {
+            seq_id seq = rp->seqs[first + s];
+            const uint8_t *shifts = seq_shifts(seq);
+            int start = rp->days[first + s];
+            for (int d = 0; d < seq_length(seq); d++) {
+                int day = start + d;
+                total += pref_cost_at(pi, e, day, shifts[d]) - (pref_off[day + 1] - pref_off[day]);
             }
-            if (incompatible) continue;
         }
-
-        current[current_len] = shift_id;
-        shift_count[shift_id]++;
-        backtrackWorkingSequence_C(pi, emp, current, current_len+1, shift_count, ssequences_pool, num_results, pool_size);
-        shift_count[shift_id]--;
+        pref[r] = (double)total;
     }
+    pool_pref[e] = pref;
 }
 
-void init_seq_index_for_employee(int emp, int max_length) {
-    seq_index[emp].max_length = max_length;
-    seq_index[emp].by_length = malloc((max_length + 1) * sizeof(int*));
-    seq_index[emp].count_by_length = calloc(max_length + 1, sizeof(int));
-    seq_index[emp].capacity_by_length = calloc(max_length + 1, sizeof(int));
+static void greedy_seed_task(int i, int thread_id, void *arg) {
+    seed_search *ss = &((seed_search *)arg)[i];
+    seed_search_init(ss, i);
+    greedy_seed(ss);
+}
 
-    if (!seq_index[emp].by_length || !seq_index[emp].count_by_length || !seq_index[emp].capacity_by_length) {
-        fprintf(stderr, "malloc failed in init_seq_index_for_employee\n");
-        exit(1);
-    }
+typedef struct {
+    population *pop;
+    seed_search *searches;
+} ils_task_arg;
+
+static void ils_individual(int i, int thread_id, void *arg) {
+    ils_task_arg *task = arg;
+    seed_search *ss = &task->searches[i];
+    ils_seed(ss);
+    write_seed(ss, &task->pop->ind[i], thread_id);
+    seed_search_free(ss);
+}
 
-    for (int l = 0; l <= max_length; l++) {
-        seq_index[emp].by_length[l] = NULL;
-        seq_index[emp].count_by_length[l] = 0;
-        seq_index[emp].capacity_by_length[l] = 0;
+/* init_type 2: semillas voraces mejoradas con ils_seed. El individuo i minimiza
+   w * obj[0] + (1 - w) * obj[1] con w = i / (popsize - 1), cada objetivo dividido
+   por su máximo entre las semillas, para que la población cubra el frente */
+static void ils_population(population *pop) {
+    int num_emps = pi->num_employees;
+    double start = wall_seconds();
+    seed_search *searches = malloc(popsize * sizeof(seed_search));
+    pool_pref = malloc(num_emps * sizeof(double *));
+    if (!searches || !pool_pref) {
+        fprintf(stderr, "malloc failed for ILS seeding\n");
+        exit(1);
     }
-}
 
-void add_seq_to_index(int emp, int length, int pool_idx) {
-    if (length > seq_index[emp].max_length) return;
+    parallel_for(num_emps, roster_pref_task, NULL);
+    parallel_for(popsize, greedy_seed_task, searches);
 
-    if (seq_index[emp].count_by_length[length] >= seq_index[emp].capacity_by_length[length]) {
-        int new_cap = (seq_index[emp].capacity_by_length[length] == 0) ? 4 : seq_index[emp].capacity_by_length[length] * 2;
-        seq_index[emp].by_length[length] = realloc(seq_index[emp].by_length[length], new_cap * sizeof(int));
-        seq_index[emp].capacity_by_length[length] = new_cap;
+    double cover_scale = 1, pref_scale = 1;
+    for (int i = 0; i < popsize; i++) {
+        if (searches[i].cover > cover_scale) cover_scale = searches[i].cover;
+        if (fabs(searches[i].pref) > pref_scale) pref_scale = fabs(searches[i].pref);
+    }
+    for (int i = 0; i < popsize; i++) {
+        double w = (popsize > 1) ? (double)i / (popsize - 1) : 0.5;
+        searches[i].cover_weight = w / cover_scale;
+        searches[i].pref_weight = (1 - w) / pref_scale;
     }
 
-    seq_index[emp].by_length[length][seq_index[emp].count_by_length[length]] = pool_idx;
-    seq_index[emp].count_by_length[length]++;
-}
+    ils_task_arg task = { pop, searches };
+    parallel_for(popsize, ils_individual, &task);
 
-/* helper para obtener turno en día dado a partir de current_emp (busca en secuencias añadidas) */
-static inline int get_shift_for_day(emp_assign *current_emp, int day) {
-    for (int i = 0; i < current_emp->num_seqs; i++) {
-        ssequence *seq = current_emp->seqs[i];
-        int start_day = current_emp->seq_start_day[i];
-        if (day >= start_day && day < start_day + seq->length) {
-            return seq->shifts[day - start_day];
-        }
-    }
-    return 0; // descanso por defecto
+    for (int e = 0; e < num_emps; e++) free(pool_pref[e]);
+    free(pool_pref);
+    pool_pref = NULL;
+    free(searches);
+    printf("ILS seeding: %d iterations per individual (reset %d, block exchange %d, block swap %d) in %.3f s\n",
+           ls_iters, ils_reset, mibe_block_size, mibs_block_size, wall_seconds() - start);
 }
 
-/* (Se mantienen las funciones can_add_sequence, violates_R2, etc. tal cual las tenías). */
-/* ... (aquí van can_add_sequence y violates_R2 tal como las definiste en tu código original) ... */
-
+/* ===================== initialize_pop integrado (usa generate_sequences_for_all + ILS) ===================== */
 
+void initialize_pop(population *pop, problem_instance *pi) {
+    printf("Initializing population and generating sequences per employee...\n");
 
+    generate_sequences_for_all(pi, 0); // genera pool de secuencias base (por tipo)
 
-bool can_add_sequence(emp_assign *current_emp){
-    int emp_id = current_emp->emp_id;
-    employee *emp = &pi->employees[emp_id];
+    int num_emps = pi->num_employees;
 
-    int horizon_length = pi->horizon_length;
-    int num_shifts = pi->num_shifts;
-
-    // Estado acumulado
-    int *shift_count = (int *)malloc(num_shifts * sizeof(int));
-    if (!shift_count) return false;
-    for (int i = 0; i < num_shifts; i++) shift_count[i] = 0;
-
-    int total_minutes = 0;
-    int consecutive_shifts = 0;
-    int consecutive_off = 0;
-    int weekcount = 0;
-
-    // Recorrer el horizonte
-    for (int day = 0; day < horizon_length; day++) {
-        int shift_id = get_shift_for_day(current_emp, day);
-
-        // R1: días libres específicos
-        for (int j = 0; j < emp->num_days_off; j++) {
-            if (emp->days_off[j] == day && shift_id != 0) {
-                free(shift_count);
-                // printf("Restr 1\n");
-                return false; // CORREGIDO: debe retornar false
-            }
+    /* ====== Crear pools de asignaciones factibles por empleado ====== */
+    employees_pool = malloc(num_emps * sizeof(roster_pool));
+    if (!employees_pool) {
+        fprintf(stderr, "malloc failed for employees_pool structures\n");
+        exit(1);
+    }
+    for (int e = 0; e < num_emps; e++) {
+        roster_pool_init(&employees_pool[e]);
+    }
+    if (pool_cache_load(pi)) {
+        printf("Roster pools read from cache %s\n", pool_cache_file());
+    } else {
+        roster_search *searches = calloc(num_emps, sizeof(roster_search));
+        if (!searches) {
+            fprintf(stderr, "malloc failed for roster searches\n");
+            exit(1);
         }
-
-        // R2: máximo por tipo de turno
-        if (shift_id > 0 && shift_id < num_shifts) {
-            shift_count[shift_id]++;
-            if (shift_count[shift_id] > emp->max_shifts[shift_id]) {
-                free(shift_count);
-                // printf("Restr 2\n");
-                return false;
-            }
+        printf("Empezando a crear (%d hilos, hasta %d rosters por empleado)\n", num_threads, roster_pool_target);
+        parallel_for(num_emps, build_employee_pool, searches);
+        long draws = 0, over_max_shifts = 0, repeated = 0;
+        int backtracked = 0;
+        for (int e = 0; e < num_emps; e++) {
+            publish_employee_pool(&searches[e], &employees_pool[e]);
+            draws += searches[e].draws;
+            over_max_shifts += searches[e].over_max_shifts;
+            repeated += searches[e].repeated;
+            backtracked += searches[e].backtracking;
+        }
+        printf("Ya se crearon: %ld rosters sorteados, %ld descartados por R2, %ld repetidos, "
+               "%d empleados por backtracking\n", draws, over_max_shifts, repeated, backtracked);
+        int timed_out = 0;
+        for (int e = 0; e < num_emps; e++) {
+            roster_search *rs = &searches[e];
+            timed_out |= rs->timed_out;
+            printf("Employee %d pool built in %.3f s: %d of %d rosters (%s %ld)%s\n", e, rs->seconds,
+                   employees_pool[e].count, roster_pool_target,
+                   rs->backtracking ? "backtracking reached" : "sampler drew",
+                   rs->backtracking ? rs->found : rs->draws,
+                   rs->timed_out ? ", time budget reached" : "");
+        }
+        free(searches);
+        /* Un pool cortado por el tiempo depende de la carga de la máquina: no se
+           guarda, para que la caché no fije ese resultado para las corridas siguientes */
+        if (pool_cache_file() != NULL && timed_out) {
+            printf("Roster pools not cached: the time budget cut some pools short\n");
+        } else if (pool_cache_file() != NULL) {
+            pool_cache_save(pi);
+            printf("Roster pools written to cache %s\n", pool_cache_file());
         }
+    }
+    /* Mostrar resumen */
+    int total_pool_size = 0;
+    size_t total_pool_bytes = 0;
+    for (int e = 0; e < num_emps; e++) {
+        roster_pool *rp = &employees_pool[e];
+        total_pool_size += rp->count;
+        total_pool_bytes += roster_pool_bytes(rp);
+        printf("Employee %d roster pool: %d rosters, %d sequences, %zu bytes", e, rp->count,
+               rp->start[rp->count], roster_pool_bytes(rp));
+        if (rp->full) printf(" (memory cap reached)");
+        printf("\n");
+    }
+    printf("Total feasible emp_assign found: %d (avg %.1f per employee)\n",
+           total_pool_size, (double)total_pool_size / num_emps);
+    printf("Roster pools: %zu bytes in total\n", total_pool_bytes);
 
-        // R3: incompatibilidades
-        // if (day > 0) {
-        //     int prev_shift = get_shift_for_day(current_emp, day - 1);
-        //     if (prev_shift > 0 && shift_id > 0) { // CORREGIDO: verificar que shift_id también sea > 0
-        //         for (int k = 0; k < pi->shifts[prev_shift].num_incompatible_shifts; k++) {
-        //             if (pi->shifts[prev_shift].incompatible_shifts[k] == shift_id) {
-        //                 free(shift_count);
-        //                 printf("Restr 1\n");
-        //                 return false;
-        //             }
-        //         }
-        //     }
-        // }
-
-        // R4: min/max consecutivos
-        // if (shift_id != 0) {
-        //     if (consecutive_off > 0) {
-        //         if (consecutive_off < emp->min_consecutive_days_off) {
-        //             free(shift_count);
-        //             printf("Restr 3\n");
-        //             return false;
-        //         }
-        //         consecutive_off = 0;
-        //     }
-        //     consecutive_shifts++;
-        //     if (consecutive_shifts > emp->max_consecutive_shifts) {
-        //         free(shift_count);
-        //         printf("Restr 3\n");
-        //         return false;
-        //     }
-        // } else {
-        //     if (consecutive_shifts > 0) {
-        //         if (consecutive_shifts < emp->min_consecutive_shifts) {
-        //             free(shift_count);
-        //             printf("Restr 3\n");
-        //             return false;
-        //         }
-        //         consecutive_shifts = 0;
-        //     }
-        //     consecutive_off++;
-        // }
-
-        // R5: fines de semana
-        if (day % 7 == 5) { // sábado
-            if (shift_id != 0) {
-                weekcount++;
-            } else if (day + 1 < horizon_length && get_shift_for_day(current_emp, day + 1) != 0) {
-                weekcount++;
+    /* ====== Inicializar población ====== */
+    if (init_type == 1) {
+        printf("Initialization: greedy coverage construction (init_type 1)\n");
+        parallel_for(popsize, greedy_individual, pop);
+    } else if (init_type == 2) {
+        printf("Initialization: greedy construction improved by ILS (init_type 2)\n");
+        ils_population(pop);
+    } else {
+        for (int i = 0; i < popsize; i++) {
+            individual *ind = &(pop->ind[i]);
+
+            memset(ind->xreal, 0, nreal * sizeof(unsigned char));
+
+            /* ====== Selección aleatoria de asignaciones factibles ====== */
+            for (int e = 0; e < num_emps; e++) {
+                int pool_size = employees_pool[e].count;
+                if (pool_size == 0) {
+                    fprintf(stderr, "Warning: no feasible sequences found for employee %d\n", e);
+                    ind->num_seqs[e] = 0;
+                    continue;
+                }
+                assign_pool_roster(ind, e, rnd(0, pool_size - 1));  // depende de la semilla
             }
-        }
 
-        total_minutes += pi->shifts[shift_id].length;
-    }
+            evaluate_ind(ind, pi);
 
-    // R6: chequeo de fines de semana
-    if (weekcount > emp->max_weekends) {
-        // printf("R6\n");
-        free(shift_count);
-        return false;
+            if (i % 10 == 0) printf("Initialization progress: built individual %d\n", i);
+        }
     }
 
-    // // R7: validación final de consecutivos
-    // // CORREGIDO: validar si terminamos en medio de una secuencia
-    // if (consecutive_shifts > 0 && consecutive_shifts < emp->min_consecutive_shifts) {
-    //     free(shift_count);
-    //     return false;
-    // }
-    // if (consecutive_off > 0 && consecutive_off < emp->min_consecutive_days_off) {
-    //     free(shift_count);
-    //     return false;
-    // }
-
-    free(shift_count);
-    return true;
+    printf("Initialization finished (popsize=%d)\n", popsize);
+    printf("Sequence table: %d distinct sequences drawn, %d bytes of shifts\n",
+           seq_table.count, seq_table.count > 0 ? seq_table.offset[seq_table.count] : 0);
 }
 
-bool violates_R2(emp_assign *current_emp, ssequence *new_seq, employee *emp, problem_instance *pi) {
-    int num_shifts = pi->num_shifts;
-    int *shift_count = (int *)calloc(num_shifts, sizeof(int));
-    if (!shift_count) return true;
 
-    // Contar turnos ya asignados
-    for (int i = 0; i < current_emp->num_seqs; i++) {
-        ssequence *seq = current_emp->seqs[i];
-        for (int d = 0; d < seq->length; d++) {
-            int sid = seq->shifts[d];
-            if (sid > 0 && sid < num_shifts)
-                shift_count[sid]++;
-        }
+/* ===================== Backtracking por empleado para construir emp_assign factibles ===================== */
+
+/* El roster parcial se lleva como estado incremental (ver roster_state):
+   push_sequence/pop_sequence lo actualizan al poner y quitar una secuencia en
+   O(largo de la secuencia), en vez de recorrer todo el horizonte en cada nodo */
+
+/* Fin de semana del sábado day: cuenta si se trabaja el sábado, o el domingo
+   con el sábado libre */
+static inline int weekend_worked(roster_search *rs, int day) {
+    if (rs->row[day] != 0) return 1;
+    return day + 1 < pi->horizon_length && rs->row[day + 1] != 0;
+}
+
+/* True si añadir seq excede max_shifts de algún turno (R2) */
+static bool exceeds_max_shifts(roster_search *rs, seq_id seq) {
+    employee *emp = &pi->employees[rs->assign.emp_id];
+    const uint8_t *shifts = seq_shifts_in(&rs->local, seq);
+    const int *counts = seq_shift_counts_in(&rs->local, seq);
+    for (int i = 0; i < seq_length_in(&rs->local, seq); i++) {
+        int s = shifts[i];
+        if (rs->shift_count[s] + counts[s] > emp->max_shifts[s]) return true;
     }
+    return false;
+}
 
-    // Contar turnos del candidato
-    for (int d = 0; d < new_seq->length; d++) {
-        int sid = new_seq->shifts[d];
-        if (sid > 0 && sid < num_shifts)
-            shift_count[sid]++;
+/* Pone seq desde day y actualiza el estado. Devuelve false si ningún roster que
+   la contenga puede ser factible: pisa un día libre pedido (R1), se pasa de
+   fines de semana (R6), alarga la racha por encima de max_consecutive_shifts o
+   cierra una racha más corta que min_consecutive_shifts (R4). El estado queda
+   actualizado igual: el llamador lo deshace con pop_sequence */
+static bool push_sequence(roster_search *rs, seq_id seq, int day) {
+    emp_assign *current_emp = &rs->assign;
+    int emp_id = current_emp->emp_id;
+    employee *emp = &pi->employees[emp_id];
+    int horizon = pi->horizon_length;
+    int length = seq_length_in(&rs->local, seq);
+    const uint8_t *shifts = seq_shifts_in(&rs->local, seq);
+    roster_state *st = &rs->state;
+    bool ok = true;
+
+    current_emp->seq_start_day[current_emp->num_seqs] = day;
+    current_emp->seqs[current_emp->num_seqs] = seq;
+    current_emp->num_seqs++;
+
+    /* R1: días libres pedidos dentro de la secuencia */
+    const int *days_off = &pi->days_off_prefix[emp_id * (horizon + 1)];
+    if (days_off[day + length] - days_off[day] > 0) ok = false;
+
+    /* R5/R6: sábados afectados (el anterior si la secuencia empieza en domingo) */
+    int first_sat = day - 1;
+    while (first_sat < 0 || first_sat % 7 != 5) first_sat++;
+    for (int sat = first_sat; sat < day + length; sat += 7) st->weekends -= weekend_worked(rs, sat);
+    for (int i = 0; i < length; i++) {
+        rs->row[day + i] = shifts[i];
+        rs->shift_count[shifts[i]]++;
     }
+    for (int sat = first_sat; sat < day + length; sat += 7) st->weekends += weekend_worked(rs, sat);
+    if (st->weekends > emp->max_weekends) ok = false;
 
-    // Validar límites
-    bool violates = false;
-    for (int s = 1; s < num_shifts; s++) {
-        if (shift_count[s] > emp->max_shifts[s]) {
-            violates = true;
-            break;
-        }
+    st->minutes += seq_total_minutes_in(&rs->local, seq);
+
+    /* R4: la secuencia alarga la racha anterior si empieza justo al terminar */
+    if (st->run_length > 0 && st->run_end == day) {
+        st->run_length += length;
+    } else {
+        if (st->run_length > 0 && st->run_length < emp->min_consecutive_shifts) ok = false;
+        st->run_length = length;
     }
+    st->run_end = day + length;
+    if (st->run_length > emp->max_consecutive_shifts) ok = false;
 
-    free(shift_count);
-    return violates;
+    return ok;
 }
 
-/* ----------------- Inserción segura de emp_assign factible en employees_pool ----------------- */
-/* Esta función se usa dentro del backtracking cuando se encuentra un emp_assign factible. */
-void store_feasible_emp_assign(emp_assign *emp_ptr) {
-    int e = emp_ptr->emp_id;
-
-    if (count_employees_pool[e] >= employees_pool_capacity[e]) {
-        employees_pool_capacity[e] *= 2;
-        employees_pool[e] = realloc(employees_pool[e],
-                                    employees_pool_capacity[e] * sizeof(emp_assign));
-        if (!employees_pool[e]) {
-            fprintf(stderr, "realloc failed for employees_pool[%d]\n", e);
-            exit(1);
-        }
+/* Quita la última secuencia (puesta desde day) y vuelve al estado saved */
+static void pop_sequence(roster_search *rs, seq_id seq, int day, const roster_state *saved) {
+    int length = seq_length_in(&rs->local, seq);
+    const uint8_t *shifts = seq_shifts_in(&rs->local, seq);
+    for (int i = 0; i < length; i++) {
+        rs->row[day + i] = 0;
+        rs->shift_count[shifts[i]]--;
     }
+    rs->assign.num_seqs--;
+    rs->state = *saved;
+}
 
-    // Copia por valor (estructuras pequeñas)
-    employees_pool[e][count_employees_pool[e]] = *emp_ptr;
-    count_employees_pool[e]++;
-
-    // No liberar emp_ptr, porque apunta a arrays útiles
+/* True si el roster parcial, con descanso hasta el final, es factible. R1, R2,
+   R6 y el máximo de R4 ya se garantizan al poner cada secuencia */
+static bool roster_complete(roster_search *rs) {
+    employee *emp = &pi->employees[rs->assign.emp_id];
+    roster_state *st = &rs->state;
+    if (st->minutes < emp->min_total_minutes || st->minutes > emp->max_total_minutes) return false;
+    return st->run_length == 0 || st->run_length >= emp->min_consecutive_shifts ||
+           st->run_end == pi->horizon_length;
 }
 
-/* ===================== Backtracking por empleado para construir emp_assign factibles ===================== */
+/* Guarda el roster parcial en la reserva (algoritmo R): los primeros
+   roster_pool_target se guardan, y el i-ésimo siguiente reemplaza a uno al azar
+   con probabilidad roster_pool_target / i */
+static void keep_roster(roster_search *rs) {
+    emp_assign *current_emp = &rs->assign;
+    long slot = rs->found++;
+    if (slot >= roster_pool_target) {
+        slot = seq_random_below(rs->found, &rs->rng);
+        if (slot >= roster_pool_target) return;
+    }
+    size_t first = (size_t)slot * pi->horizon_length;
+    for (int k = 0; k < current_emp->num_seqs; k++) {
+        rs->kept_seqs[first + k] = current_emp->seqs[k];
+        rs->kept_days[first + k] = current_emp->seq_start_day[k];
+    }
+    rs->kept_length[slot] = current_emp->num_seqs;
+}
 
-void backtracking_employee_seq(emp_assign *current_emp, int day,
-                               int consecutive_shifts, int consecutive_off) {
+void backtracking_employee_seq(roster_search *rs, int day) {
+    emp_assign *current_emp = &rs->assign;
     int emp_id = current_emp->emp_id;
 
-    /* ====== Caso base ====== */
-    if (eval_employee_feasible(current_emp, pi)) {
-            // printf("Alo...");
-            int emp_id = current_emp->emp_id;
-
-            /* Crear copia dinámica completa (deep copy) */
-            emp_assign *aux_emp = malloc(sizeof(emp_assign));
-            // if (!aux_emp) {
-            //     fprintf(stderr, "malloc failed for aux_emp struct\n");
-            //     exit(1);
-            // }
-
-            aux_emp->emp_id = emp_id;
-            aux_emp->num_seqs = current_emp->num_seqs;
-
-            if (aux_emp->num_seqs > 0) {
-                aux_emp->seq_start_day = malloc(aux_emp->num_seqs * sizeof(int));
-                aux_emp->seqs = malloc(aux_emp->num_seqs * sizeof(ssequence*));
-                // if (!aux_emp->seq_start_day || !aux_emp->seqs) {
-                //     fprintf(stderr, "malloc failed copying aux_emp arrays\n");
-                //     free(aux_emp);
-                //     exit(1);
-                // }
-
-                for (int i = 0; i < aux_emp->num_seqs; i++) {
-                    aux_emp->seq_start_day[i] = current_emp->seq_start_day[i];
-                    aux_emp->seqs[i] = current_emp->seqs[i]; // punteros compartidos
-                }
-            } else {
-                aux_emp->seq_start_day = NULL;
-                aux_emp->seqs = NULL;
-            }
+    /* Se acabó roster_pool_seconds (se mira cada 1024 nodos) */
+    if (rs->timed_out || ((++rs->nodes & 1023) == 0 && out_of_time(rs))) return;
 
-            store_feasible_emp_assign(aux_emp);
-            // printf("Adios\n");
-            return;
-        }
+    /* ====== Caso base ====== */
+    if (roster_complete(rs)) {
+        keep_roster(rs);
+        return;
+    }
 
     /* ====== Determinar rango de largos posibles ====== */
-    int max_length = seq_index[emp_id].max_length;
+    int max_length = seq_index[emp_id]->max_length;
     if (day + max_length > pi->horizon_length)
         max_length = pi->horizon_length - day;
 
@@ -693,31 +935,36 @@ void backtracking_employee_seq(emp_assign *current_emp, int day,
     if (day == 0 || day >= pi->horizon_length - min_length)
         min_length = 1;
 
+    /* Solo se sortean secuencias compatibles con la anterior (si termina el día
+       previo) y que caben en los minutos que quedan */
+    seq_query q;
+    q.prev_shift = (day > 0) ? rs->row[day - 1] : 0;
+    q.next_shift = 0;
+    q.min_minutes = 0;
+    q.max_minutes = pi->employees[emp_id].max_total_minutes - rs->state.minutes;
+
     /* ====== OPCIÓN 1: Asignar secuencia de trabajo ====== */
     for (int i = min_length; i <= max_length; i++) {
-        int available = seq_index[emp_id].count_by_length[i];
+        q.length = i;
+        int64_t available = seq_query_count(pi, seq_index[emp_id], &q);
         if (available == 0) continue;
 
         employee *emp = &pi->employees[emp_id];
 
         /* Probar varias secuencias aleatorias de este largo (hasta available intentos) */
-        for (int attempt = 0; attempt < available; attempt++) {
-            int seq_num = rnd(0, available-1); /* asumo rnd devuelve [0, available-1] */
-            int seq_idx = seq_index[emp_id].by_length[i][seq_num];
-            ssequence *ch_seq = ssequences_pool_emp[emp_id][seq_idx];
+        for (int64_t attempt = 0; attempt < available; attempt++) {
+            int64_t seq_num = seq_random_below(available, &rs->rng);
+            seq_id ch_seq = seq_query_unrank(&rs->local, pi, emp_id, &q, seq_num);
 
             /* Chequear restricción R2 */
-            if (violates_R2(current_emp, ch_seq, emp, pi)) {
+            if (exceeds_max_shifts(rs, ch_seq)) {
                 continue;
             }
 
-            /* Agregar secuencia (apuntar al pool) */
-            current_emp->seq_start_day[current_emp->num_seqs] = day;
-            current_emp->seqs[current_emp->num_seqs] = ch_seq;
-            current_emp->num_seqs++;
-
-            if (can_add_sequence(current_emp)) {
-                int next_day = day + ch_seq->length;
+            /* Agregar secuencia */
+            roster_state saved = rs->state;
+            if (push_sequence(rs, ch_seq, day)) {
+                int next_day = day + seq_length_in(&rs->local, ch_seq);
 
                 /* CASO A: Después de la secuencia, poner días OFF */
                 int min_off = emp->min_consecutive_days_off;
@@ -725,20 +972,18 @@ void backtracking_employee_seq(emp_assign *current_emp, int day,
 
                 for (int days_off = min_off; days_off <= max_off; days_off++) {
                     if (next_day + days_off <= pi->horizon_length) {
-                        backtracking_employee_seq(current_emp,
-                                                  next_day + days_off,
-                                                  0, days_off);
+                        backtracking_employee_seq(rs, next_day + days_off);
                     }
                 }
 
                 /* CASO B: Terminar justo al final */
                 if (next_day == pi->horizon_length) {
-                    backtracking_employee_seq(current_emp, next_day, 0, 0);
+                    backtracking_employee_seq(rs, next_day);
                 }
             }
 
             /* Deshacer */
-            current_emp->num_seqs--;
+            pop_sequence(rs, ch_seq, day, &saved);
             break; /* ya intentamos una secuencia válida para este largo; pasar al siguiente largo */
         }
     }
@@ -750,9 +995,7 @@ void backtracking_employee_seq(emp_assign *current_emp, int day,
         if (max_off < min_off) max_off = min_off;
         for (int days_off = min_off; days_off <= max_off; days_off++) {
             if (day + days_off <= pi->horizon_length) {
-                backtracking_employee_seq(current_emp,
-                                          day + days_off,
-                                          0, days_off);
+                backtracking_employee_seq(rs, day + days_off);
             }
         }
     }
@@ -4,12 +4,7 @@
 #include "rand.h"
 #include "time.h"
 
-extern ssequence ***ssequences_pool_emp; // pools per employee
-extern int *num_sequences_pool_emp;      // number of sequences per employee
-extern seq_length_index *seq_index;
-
-extern emp_assign **employees_pool;
-extern int *count_employees_pool;
+extern roster_pool *employees_pool;
 
 extern double mut1_p;
 extern double mut2_p;
@@ -28,7 +23,36 @@ void mutation_change(individual *ind, problem_instance *pi, int emp);
 void mutation_replace_from_pool(individual *ind, problem_instance *pi, int emp); // MUT5
 int check_overlap(int start1, int len1, int start2, int len2);
 void remove_overlapping_sequences(individual *ind, int emp, int new_start, int new_len);
-double eval_seq_preference(int current_pref, ssequence *new_seq, int day, int emp, problem_instance *pi);
+double eval_seq_preference(individual *ind, seq_id new_seq, int day, int emp, problem_instance *pi);
+
+/* Turno de emp el día day según sus secuencias, sin contar las que se solapan
+   con [start, start + length) (0 = libre o fuera del horizonte) */
+static int shift_outside_span(individual *ind, int emp, int day, int start, int length) {
+    for (int i = 0; i < ind->num_seqs[emp]; i++) {
+        seq_id seq = ind->seqs[emp][i];
+        int s = ind->seq_start_days[emp][i];
+        if (check_overlap(start, length, s, seq_length(seq))) continue;
+        if (day >= s && day < s + seq_length(seq)) return seq_shifts(seq)[day - s];
+    }
+    return 0;
+}
+
+/* Secuencias de largo length que caben en [start, start + length) de emp: compatibles
+   con los turnos del día anterior y posterior y dentro de los minutos que dejan las
+   demás secuencias (las que se solapan con el tramo se eliminan al reemplazar) */
+static void span_query(seq_query *q, individual *ind, problem_instance *pi, int emp, int start, int length) {
+    int used = 0;
+    for (int i = 0; i < ind->num_seqs[emp]; i++) {
+        seq_id seq = ind->seqs[emp][i];
+        if (!check_overlap(start, length, ind->seq_start_days[emp][i], seq_length(seq)))
+            used += seq_total_minutes(seq);
+    }
+    q->length = length;
+    q->prev_shift = shift_outside_span(ind, emp, start - 1, start, length);
+    q->next_shift = shift_outside_span(ind, emp, start + length, start, length);
+    q->min_minutes = 0;
+    q->max_minutes = pi->employees[emp].max_total_minutes - used;
+}
 
 
 void mutation_pop(population *pop, problem_instance *pi) {
@@ -49,6 +73,12 @@ void mutation_ind_sequence(individual *ind, problem_instance *pi) {
 
     if (num_sequences_pool_emp[emp] == 0) return;
 
+    // La cobertura viva es la base de los puntajes de las mutaciones guiadas
+    if (!ind->eval_valid) rebuild_coverage(ind, pi, default_eval_ctx);
+
+    // Solo este empleado debe reevaluarse
+    ind->emp_dirty[emp] = 1;
+
     // Probabilidades ponderadas
     double total_p = mut1_p + mut2_p + mut3_p + mut4_p + mut5_p;
     double r = randomperc();
@@ -72,14 +102,20 @@ void mutation_ind_sequence(individual *ind, problem_instance *pi) {
         case 3: mutation_change(ind, pi, emp); break;
         case 4: mutation_replace_from_pool(ind, pi, emp); break;
     }
+    refresh_employee_cover(ind, pi, emp, default_eval_ctx);
 }
 
 /* ===================== MUTACIONES CLÁSICAS ===================== */
 
 
-double eval_seq_preference(int current_pref, ssequence *new_seq, int day, int emp, problem_instance *pi) {
-    int length = new_seq->length;
+/* Puntaje (mayor es mejor) de poner new_seq desde day en el roster de emp: menos
+   su costo de preferencias y el cambio real de obj[0] al reemplazar lo que emp
+   cubre hoy en el tramo, según la cobertura viva del individuo */
+double eval_seq_preference(individual *ind, seq_id new_seq, int day, int emp, problem_instance *pi) {
+    int length = seq_length(new_seq);
+    const uint8_t *shifts = seq_shifts(new_seq);
     int num_shifts = pi->num_shifts;
+    const unsigned char *old_col = &ind->emp_cover[emp * pi->horizon_length];
 
     // Evitar overflow de horizonte
     if (day + length > pi->horizon_length) return -1e9;
@@ -88,23 +124,22 @@ double eval_seq_preference(int current_pref, ssequence *new_seq, int day, int em
 
     for (int i = 0; i < length; i++) {
         int d = day + i;
-        int s = new_seq->shifts[i]; // el turno asignado en este día
-
-        if (s == 0) continue; // turno vacío
-
-        int required = pi->cover_requirements[d][s];
-
-        // asumimos que actualmente no hay cobertura de otros empleados para simplificar
-        int actual = 1; 
-
-        if (actual < required) {
-            obj += (required - actual) * pi->under_cover_weights[d][s];
-        } else if (actual > required) {
-            obj += (actual - required) * pi->over_cover_weights[d][s];
-        }
+        int s = shifts[i]; // el turno asignado en este día
+
+        // costo de preferencias (obj[1]) de asignar este turno
+        obj += pref_cost_at(pi, emp, d, s);
+
+        // cambio de cobertura (obj[0]); los días libres (R1) no cubren
+        int old_shift = old_col[d];
+        int new_shift = is_day_off(pi, emp, d) ? 0 : s;
+        if (old_shift == new_shift) continue;
+        if (old_shift > 0)
+            obj += cover_change(pi, d, old_shift, ind->coverage[d * num_shifts + old_shift], -1);
+        if (new_shift > 0)
+            obj += cover_change(pi, d, new_shift, ind->coverage[d * num_shifts + new_shift], 1);
     }
 
-    return current_pref - obj;
+    return -obj;
 }
 
 
@@ -113,17 +148,19 @@ void mutation_adaptive_replace(individual *ind, problem_instance *pi, int emp) {
 
     // Elegir una secuencia al azar
     int seq_idx = rnd(0, ind->num_seqs[emp] - 1);
-    ssequence *current_seq = ind->seqs[emp][seq_idx];
+    seq_id current_seq = ind->seqs[emp][seq_idx];
     int current_start = ind->seq_start_days[emp][seq_idx];
-    int current_length = current_seq->length;
+    int current_length = seq_length(current_seq);
 
-    seq_length_index *idx = &seq_index[emp];
+    seq_length_index *idx = seq_index[emp];
+    seq_query q;
 
-    // Buscar un largo menor disponible en el índice de secuencias
+    // Buscar un largo menor con secuencias que quepan en el tramo
     int candidate_lengths[64];  // buffer auxiliar
     int count = 0;
-    for (int l = 1; l < current_length; l++) {
-        if (idx->count_by_length[l] > 0) {
+    for (int l = 1; l < current_length && count < 64; l++) {
+        span_query(&q, ind, pi, emp, current_start, l);
+        if (seq_query_count(pi, idx, &q) > 0) {
             candidate_lengths[count++] = l;
         }
     }
@@ -133,49 +170,54 @@ void mutation_adaptive_replace(individual *ind, problem_instance *pi, int emp) {
     // Elegir un largo menor aleatorio
     int new_length = candidate_lengths[rnd(0, count - 1)];
 
-    // Evaluar todas las secuencias de ese largo
+    // Evaluar todas las secuencias de ese largo que caben
     double best_score = -1e9;
-    ssequence *best_seq = NULL;
+    int found = 0;
+    seq_id best_seq = 0;
 
-    for (int i = 0; i < idx->count_by_length[new_length]; i++) {
-        int pool_idx = idx->by_length[new_length][i];
-        ssequence *candidate = ssequences_pool_emp[emp][pool_idx];
+    span_query(&q, ind, pi, emp, current_start, new_length);
+    int64_t num_candidates = seq_query_count(pi, idx, &q);
+    int sampled = (num_candidates > SEQ_SCAN_LIMIT);
+    for (int64_t i = 0; i < (sampled ? SEQ_SCAN_LIMIT : num_candidates); i++) {
+        int64_t rank = sampled ? seq_random_below(num_candidates, &global_rand) : i;
+        seq_id candidate = seq_query_unrank(&seq_table, pi, emp, &q, rank);
 
         // Evitar acceder fuera del horizonte
-        if (current_start + candidate->length > pi->horizon_length) continue;
+        if (current_start + seq_length(candidate) > pi->horizon_length) continue;
 
-        double score = eval_seq_preference(0, candidate, current_start, emp, pi);
+        double score = eval_seq_preference(ind, candidate, current_start, emp, pi);
 
         if (score > best_score) {
             best_score = score;
             best_seq = candidate;
+            found = 1;
         }
     }
 
-    // Si encontramos algo mejor, reemplazamos
-    if (best_seq != NULL) {
-        remove_overlapping_sequences(ind, emp, current_start, best_seq->length);
-        ind->seqs[emp][seq_idx] = best_seq;
-        ind->seq_start_days[emp][seq_idx] = current_start;
+    // Si encontramos algo mejor, reemplazamos (la secuencia actual se solapa y se elimina)
+    if (found) {
+        remove_overlapping_sequences(ind, emp, current_start, seq_length(best_seq));
+        ind->seqs[emp][ind->num_seqs[emp]] = best_seq;
+        ind->seq_start_days[emp][ind->num_seqs[emp]] = current_start;
+        ind->num_seqs[emp]++;
     }
 }
 
 void mutation_add(individual *ind, problem_instance *pi, int emp) {
     if (num_sequences_pool_emp[emp] == 0) return;
 
-    seq_length_index *idx = &seq_index[emp];
+    seq_length_index *idx = seq_index[emp];
     int length;
     do { length = rnd(1, idx->max_length); } while (idx->count_by_length[length] == 0);
 
-    int pos = rnd(0, idx->count_by_length[length] - 1);
-    int pool_idx = idx->by_length[length][pos];
-    ssequence *seq = ssequences_pool_emp[emp][pool_idx];
+    int64_t pos = seq_random_rank(idx, length, &global_rand);
+    seq_id seq = seq_unrank(&seq_table, pi, emp, length, pos);
 
     int horizon = pi->horizon_length;
-    if (seq->length > horizon) return;
+    if (length > horizon) return;
 
-    int start_day = rnd(0, horizon - seq->length);
-    remove_overlapping_sequences(ind, emp, start_day, seq->length);
+    int start_day = rnd(0, horizon - length);
+    remove_overlapping_sequences(ind, emp, start_day, length);
 
     ind->seqs[emp][ind->num_seqs[emp]] = seq;
     ind->seq_start_days[emp][ind->num_seqs[emp]] = start_day;
@@ -186,18 +228,23 @@ void mutation_shift_local(individual *ind, problem_instance *pi, int emp) {
     if (ind->num_seqs[emp] <= 0) return;
 
     int seq_idx = rnd(0, ind->num_seqs[emp] - 1);
-    ssequence *seq = ind->seqs[emp][seq_idx];
+    seq_id seq = ind->seqs[emp][seq_idx];
+    int length = seq_length(seq);
     int current_start = ind->seq_start_days[emp][seq_idx];
     int horizon = pi->horizon_length;
 
     int delta = rnd(-3, 3);  // desplazamiento pequeño
     int new_start = current_start + delta;
 
-    if (new_start < 0 || new_start + seq->length > horizon)
+    if (new_start < 0 || new_start + length > horizon)
         return;
 
-    remove_overlapping_sequences(ind, emp, new_start, seq->length);
-    ind->seq_start_days[emp][seq_idx] = new_start;
+    // La secuencia desplazada se solapa consigo misma y también se elimina
+    remove_overlapping_sequences(ind, emp, current_start, length);
+    remove_overlapping_sequences(ind, emp, new_start, length);
+    ind->seqs[emp][ind->num_seqs[emp]] = seq;
+    ind->seq_start_days[emp][ind->num_seqs[emp]] = new_start;
+    ind->num_seqs[emp]++;
 }
 
 
@@ -206,32 +253,30 @@ void mutation_change(individual *ind, problem_instance *pi, int emp) {
     if (ind->num_seqs[emp] <= 0) return;
 
     int seq_idx = rnd(0, ind->num_seqs[emp] - 1);
-    ssequence *current_seq = ind->seqs[emp][seq_idx];
+    seq_id current_seq = ind->seqs[emp][seq_idx];
     int current_start = ind->seq_start_days[emp][seq_idx];
-    int length = current_seq->length;
+    int length = seq_length(current_seq);
 
-    seq_length_index *idx = &seq_index[emp];
-    if (idx->count_by_length[length] <= 1) return;
+    seq_length_index *idx = seq_index[emp];
+    seq_query q;
+    span_query(&q, ind, pi, emp, current_start, length);
+    int64_t num_candidates = seq_query_count(pi, idx, &q);
+    if (num_candidates == 0) return;
 
-    ssequence *best_seq = current_seq;
-    double best_score = eval_seq_preference(0, current_seq, current_start, emp, pi); // evaluar la secuencia actual
+    seq_id best_seq = current_seq;
+    double best_score = eval_seq_preference(ind, current_seq, current_start, emp, pi); // evaluar la secuencia actual
 
-    // Probar todas las secuencias del mismo largo
-    for (int i = 0; i < idx->count_by_length[length]; i++) {
-        int pool_idx = idx->by_length[length][i];
-        ssequence *candidate = ssequences_pool_emp[emp][pool_idx];
+    // Probar las secuencias del mismo largo que caben en el tramo
+    int sampled = (num_candidates > SEQ_SCAN_LIMIT);
+    for (int64_t i = 0; i < (sampled ? SEQ_SCAN_LIMIT : num_candidates); i++) {
+        int64_t rank = sampled ? seq_random_below(num_candidates, &global_rand) : i;
+        seq_id candidate = seq_query_unrank(&seq_table, pi, emp, &q, rank);
 
         // Evitar reemplazar por la misma secuencia
         if (candidate == current_seq) continue;
 
-        // Temporal: eliminar solapamientos de la secuencia actual
-        remove_overlapping_sequences(ind, emp, current_start, candidate->length);
-
-        // Evaluar preferencia
-        double score = eval_seq_preference(0, candidate, current_start, emp, pi);
-
-        // Restaurar la secuencia original antes de probar el siguiente candidato
-        ind->seqs[emp][seq_idx] = current_seq;
+        // Evaluar preferencia y cobertura (no hace falta tocar el roster)
+        double score = eval_seq_preference(ind, candidate, current_start, emp, pi);
 
         if (score > best_score) {
             best_score = score;
@@ -240,28 +285,32 @@ void mutation_change(individual *ind, problem_instance *pi, int emp) {
     }
 
     // Reemplazar finalmente por la mejor secuencia encontrada
-    remove_overlapping_sequences(ind, emp, current_start, best_seq->length);
-    ind->seqs[emp][seq_idx] = best_seq;
+    if (best_seq == current_seq) return;
+    remove_overlapping_sequences(ind, emp, current_start, seq_length(best_seq));
+    ind->seqs[emp][ind->num_seqs[emp]] = best_seq;
+    ind->seq_start_days[emp][ind->num_seqs[emp]] = current_start;
+    ind->num_seqs[emp]++;
 }
 
 
 /* ===================== MUT5: INTERCAMBIO CON EMPLOYEE POOL ===================== */
 
 void mutation_replace_from_pool(individual *ind, problem_instance *pi, int emp) {
-    if (count_employees_pool[emp] == 0) return;
+    roster_pool *rp = &employees_pool[emp];
+    if (rp->count == 0) return;
 
-    int choice = rnd(0, count_employees_pool[emp] - 1);
-    emp_assign *replacement = &employees_pool[emp][choice];
+    int choice = rnd(0, rp->count - 1);
+    int first = rp->start[choice];
 
     // Limpiar las secuencias actuales del empleado
     ind->num_seqs[emp] = 0;
 
     // Asignar las secuencias desde la pool
-    for (int i = 0; i < replacement->num_seqs; i++) {
-        ssequence *seq = replacement->seqs[i];
-        int start_day = replacement->seq_start_day[i];
+    for (int i = 0; i < roster_length(rp, choice); i++) {
+        seq_id seq = rp->seqs[first + i];
+        int start_day = rp->days[first + i];
 
-        remove_overlapping_sequences(ind, emp, start_day, seq->length);
+        remove_overlapping_sequences(ind, emp, start_day, seq_length(seq));
 
         ind->seqs[emp][ind->num_seqs[emp]] = seq;
         ind->seq_start_days[emp][ind->num_seqs[emp]] = start_day;
@@ -282,7 +331,7 @@ int check_overlap(int start1, int len1, int start2, int len2) {
 void remove_overlapping_sequences(individual *ind, int emp, int new_start, int new_len) {
     for (int i = ind->num_seqs[emp] - 1; i >= 0; i--) {
         int existing_start = ind->seq_start_days[emp][i];
-        int existing_len = ind->seqs[emp][i]->length;
+        int existing_len = seq_length(ind->seqs[emp][i]);
         if (check_overlap(new_start, new_len, existing_start, existing_len)) {
             for (int j = i; j < ind->num_seqs[emp] - 1; j++) {
                 ind->seqs[emp][j] = ind->seqs[emp][j + 1];
@@ -0,0 +1,184 @@
+/* Non-dominated front assignment on index arrays.
+   For two objectives it uses a sort-and-sweep in O(N log N); otherwise (or when a
+   constraint violation is not <= 0) it falls back to pairwise check_dominance */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <math.h>
+
+# include "global.h"
+
+static population *sort_pop; // Population being sorted by the qsort comparators
+
+/* Feasible (obj[0], obj[1], index) ascending */
+static int compare_objectives (const void *pa, const void *pb)
+{
+    individual *a = &sort_pop->ind[*(const int *)pa];
+    individual *b = &sort_pop->ind[*(const int *)pb];
+    if (a->obj[0] != b->obj[0]) return (a->obj[0] < b->obj[0]) ? -1 : 1;
+    if (a->obj[1] != b->obj[1]) return (a->obj[1] < b->obj[1]) ? -1 : 1;
+    return *(const int *)pa - *(const int *)pb;
+}
+
+/* Infeasible: constraint violation descending (closest to 0 first), then index */
+static int compare_violation (const void *pa, const void *pb)
+{
+    individual *a = &sort_pop->ind[*(const int *)pa];
+    individual *b = &sort_pop->ind[*(const int *)pb];
+    if (a->constr_violation != b->constr_violation) return (a->constr_violation > b->constr_violation) ? -1 : 1;
+    return *(const int *)pa - *(const int *)pb;
+}
+
+/* Members by (rank, index) */
+static int compare_front (const void *pa, const void *pb)
+{
+    individual *a = &sort_pop->ind[*(const int *)pa];
+    individual *b = &sort_pop->ind[*(const int *)pb];
+    if (a->rank != b->rank) return a->rank - b->rank;
+    return *(const int *)pa - *(const int *)pb;
+}
+
+/* True if a (earlier in objective order) dominates b */
+static int sweep_dominates (individual *a, individual *b)
+{
+    return a->obj[1] < b->obj[1] || (a->obj[1] == b->obj[1] && a->obj[0] < b->obj[0]);
+}
+
+/* Ranks the n feasible members with the two-objective sweep, starting at first_rank.
+   Returns the number of fronts */
+static int sweep_fronts (population *pop, int *members, int n, int first_rank)
+{
+    int *last = (int *)malloc((n > 0 ? n : 1) * sizeof(int)); // Last member added to each front
+    int nfronts = 0;
+
+    sort_pop = pop;
+    qsort (members, n, sizeof(int), compare_objectives);
+    for (int k = 0; k < n; k++)
+    {
+        individual *p = &pop->ind[members[k]];
+        // First front whose last member does not dominate p
+        int lo = 0, hi = nfronts;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (sweep_dominates (&pop->ind[last[mid]], p)) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == nfronts) nfronts++;
+        last[lo] = members[k];
+        p->rank = first_rank + lo;
+    }
+    free (last);
+    return nfronts;
+}
+
+/* Generic peeling with check_dominance (any nobj, any constraint violation) */
+static int generic_fronts (population *pop, int *members, int n, int first_rank)
+{
+    int *dom_count = (int *)calloc(n > 0 ? n : 1, sizeof(int));
+    int *current = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+    int *next = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+    int ncur = 0, rank = first_rank;
+
+    for (int a = 0; a < n; a++)
+    {
+        for (int b = a + 1; b < n; b++)
+        {
+            int flag = check_dominance (&pop->ind[members[a]], &pop->ind[members[b]]);
+            if (flag == 1) dom_count[b]++;
+            if (flag == -1) dom_count[a]++;
+        }
+    }
+    for (int a = 0; a < n; a++)
+    {
+        if (dom_count[a] == 0) current[ncur++] = a;
+    }
+    while (ncur > 0)
+    {
+        int nnext = 0;
+        for (int c = 0; c < ncur; c++)
+        {
+            pop->ind[members[current[c]]].rank = rank;
+            dom_count[current[c]] = -1;
+        }
+        for (int c = 0; c < ncur; c++)
+        {
+            for (int b = 0; b < n; b++)
+            {
+                if (dom_count[b] > 0 && check_dominance (&pop->ind[members[current[c]]], &pop->ind[members[b]]) == 1)
+                {
+                    if (--dom_count[b] == 0) next[nnext++] = b;
+                }
+            }
+        }
+        int *swap = current;
+        current = next;
+        next = swap;
+        ncur = nnext;
+        rank++;
+    }
+    free (dom_count);
+    free (current);
+    free (next);
+    return rank - first_rank;
+}
+
+/* Assigns the non-domination rank (from first_rank on) of the n individuals of pop
+   listed in members, and reorders members by (rank, index). front_start (n+1
+   entries) receives where each front begins. Returns the number of fronts */
+int assign_fronts (population *pop, int *members, int n, int first_rank, int *front_start)
+{
+    int nfronts = 0;
+    int generic = (nobj != 2);
+
+    for (int k = 0; k < n && !generic; k++)
+    {
+        individual *ind = &pop->ind[members[k]];
+        if (!(ind->constr_violation <= 0.0) || isnan(ind->obj[0]) || isnan(ind->obj[1])) generic = 1;
+    }
+
+    if (generic)
+    {
+        nfronts = generic_fronts (pop, members, n, first_rank);
+    }
+    else
+    {
+        // Any feasible individual dominates every infeasible one
+        int nfeasible = 0;
+        for (int k = 0; k < n; k++)
+        {
+            if (pop->ind[members[k]].constr_violation == 0.0)
+            {
+                int tmp = members[nfeasible];
+                members[nfeasible++] = members[k];
+                members[k] = tmp;
+            }
+        }
+        nfronts = sweep_fronts (pop, members, nfeasible, first_rank);
+
+        // Infeasible individuals only compare by violation: one front per distinct value
+        sort_pop = pop;
+        qsort (members + nfeasible, n - nfeasible, sizeof(int), compare_violation);
+        for (int k = nfeasible; k < n; k++)
+        {
+            if (k == nfeasible || pop->ind[members[k]].constr_violation != pop->ind[members[k-1]].constr_violation)
+            {
+                nfronts++;
+            }
+            pop->ind[members[k]].rank = first_rank + nfronts - 1;
+        }
+    }
+
+    sort_pop = pop;
+    qsort (members, n, sizeof(int), compare_front);
+    int f = 0;
+    for (int k = 0; k < n; k++)
+    {
+        if (k == 0 || pop->ind[members[k]].rank != pop->ind[members[k-1]].rank)
+        {
+            front_start[f++] = k;
+        }
+    }
+    front_start[f] = n;
+    return nfronts;
+}
@@ -1,4 +1,6 @@
 
+# define _POSIX_C_SOURCE 200809L
+
 # include <stdio.h>
 # include <stdlib.h>
 # include <math.h>
@@ -12,6 +14,14 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+/* Wall clock seconds: clock() adds up the CPU time of every worker thread */
+double wall_seconds (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 int nreal;
 int nbin;
 int nobj;
@@ -71,6 +81,7 @@ int main (int argc, char **argv)
     FILE *fpt5;
     FILE *fpt6;
     FILE *fpt7;
+    FILE *fpt8;
 
     pi = malloc(sizeof(problem_instance));
     population *parent_pop;
@@ -91,11 +102,14 @@ int main (int argc, char **argv)
     fpt3 = fopen("best_pop.out","w");
     fpt4 = fopen("all_pop.out","w");
     fpt5 = fopen("params.out","w");
+    fpt8 = fopen("duplicates.out","w");
     fprintf(fpt1,"# This file contains the data of initial population\n");
     fprintf(fpt2,"# This file contains the data of final population\n");
     fprintf(fpt3,"# This file contains the data of final feasible population (if found)\n");
     fprintf(fpt4,"# This file contains the data of all generations\n");
     fprintf(fpt5,"# This file contains information about inputs as read by the program\n");
+    fprintf(fpt8,"# This file contains, per generation, the children not evaluated because a parent or an earlier child had the same genotype, and the duplicates in the merged population\n");
+    fprintf(fpt8,"# gen, skipped evaluations, duplicates in mixed population\n");
 
     char * instance_route = argv[2];
     readInputFile(instance_route, pi);
@@ -269,6 +283,92 @@ int main (int argc, char **argv)
         exit (1);
     }
 
+    // Optional: threads used to decode and evaluate populations (argv[24] or NSGA2_THREADS)
+    int nthreads = 1;
+    if (argc > 24) {
+        nthreads = atoi(argv[24]);
+    } else if (getenv("NSGA2_THREADS") != NULL) {
+        nthreads = atoi(getenv("NSGA2_THREADS"));
+    }
+    if (nthreads<1){
+        printf("\n Number of threads entered is : %d",nthreads);
+        printf("\n Wrong number of threads entered, hence exiting \n");
+        exit (1);
+    }
+
+    // Optional: roster cache entries per thread (argv[25] or NSGA2_ROSTER_CACHE, 0 disables it)
+    if (argc > 25) {
+        roster_cache_size = atoi(argv[25]);
+    } else if (getenv("NSGA2_ROSTER_CACHE") != NULL) {
+        roster_cache_size = atoi(getenv("NSGA2_ROSTER_CACHE"));
+    }
+    if (roster_cache_size<0){
+        printf("\n Roster cache size entered is : %d",roster_cache_size);
+        printf("\n Wrong roster cache size entered, hence exiting \n");
+        exit (1);
+    }
+    default_eval_ctx = allocate_eval_context(pi);
+    threadpool_init(nthreads, pi);
+
+    // Optional: keep duplicated genotypes only to fill the population (argv[26] or NSGA2_DEMOTE_DUPLICATES)
+    if (argc > 26) {
+        demote_duplicates = atoi(argv[26]);
+    } else if (getenv("NSGA2_DEMOTE_DUPLICATES") != NULL) {
+        demote_duplicates = atoi(getenv("NSGA2_DEMOTE_DUPLICATES"));
+    }
+    if (demote_duplicates<0 || demote_duplicates>1){
+        printf("\n Demote duplicates entered is : %d",demote_duplicates);
+        printf("\n Wrong demote duplicates value entered, hence exiting \n");
+        exit (1);
+    }
+
+    // Optional: memory cap in KB of each employee's roster pool (argv[27] or NSGA2_ROSTER_POOL_KB, 0 = unlimited)
+    int roster_pool_kb = 0;
+    if (argc > 27) {
+        roster_pool_kb = atoi(argv[27]);
+    } else if (getenv("NSGA2_ROSTER_POOL_KB") != NULL) {
+        roster_pool_kb = atoi(getenv("NSGA2_ROSTER_POOL_KB"));
+    }
+    if (roster_pool_kb<0){
+        printf("\n Roster pool cap entered is : %d",roster_pool_kb);
+        printf("\n Wrong roster pool cap entered, hence exiting \n");
+        exit (1);
+    }
+    roster_pool_max_bytes = (long)roster_pool_kb * 1024;
+
+    // Optional: distinct rosters drawn for each employee's pool (argv[29] or NSGA2_ROSTER_POOL_SIZE)
+    if (argc > 29) {
+        roster_pool_target = atoi(argv[29]);
+    } else if (getenv("NSGA2_ROSTER_POOL_SIZE") != NULL) {
+        roster_pool_target = atoi(getenv("NSGA2_ROSTER_POOL_SIZE"));
+    }
+    if (roster_pool_target<1){
+        printf("\n Roster pool size entered is : %d",roster_pool_target);
+        printf("\n Wrong roster pool size entered, hence exiting \n");
+        exit (1);
+    }
+
+    // Optional: wall-clock budget in seconds to build each employee's pool (argv[30] or NSGA2_ROSTER_POOL_SECONDS, 0 = unlimited)
+    if (argc > 30) {
+        roster_pool_seconds = atof(argv[30]);
+    } else if (getenv("NSGA2_ROSTER_POOL_SECONDS") != NULL) {
+        roster_pool_seconds = atof(getenv("NSGA2_ROSTER_POOL_SECONDS"));
+    }
+    if (roster_pool_seconds<0){
+        printf("\n Roster pool time budget entered is : %g",roster_pool_seconds);
+        printf("\n Wrong roster pool time budget entered, hence exiting \n");
+        exit (1);
+    }
+
+    // Optional: directory of the roster pool cache (argv[28] or NSGA2_POOL_CACHE, "0" disables it)
+    const char *pool_cache_dir = "pool_cache";
+    if (argc > 28) {
+        pool_cache_dir = argv[28];
+    } else if (getenv("NSGA2_POOL_CACHE") != NULL) {
+        pool_cache_dir = getenv("NSGA2_POOL_CACHE");
+    }
+    pool_cache_configure(pool_cache_dir, instance_route);
+
     //imprimir todos los parametros
     printf("\n Instance route = %s",instance_route);
     printf("\n Population size = %d",popsize);
@@ -300,6 +400,7 @@ int main (int argc, char **argv)
     printf("\n Probability of crossover 2 = %e",cross2_p);
     printf("\n run number = %d",run_number);
     printf("\n run mode = %d",run_mode);
+    printf("\n threads = %d",num_threads);
 
     
 
@@ -307,6 +408,12 @@ int main (int argc, char **argv)
     fprintf(fpt5,"\n Population size = %d",popsize);
     fprintf(fpt5,"\n Number of generations = %d",ngen);
     fprintf(fpt5,"\n Number of objective functions = %d",nobj);
+    fprintf(fpt5,"\n Number of threads = %d",num_threads);
+    fprintf(fpt5,"\n Demote duplicates = %d",demote_duplicates);
+    fprintf(fpt5,"\n Roster pool cap per employee (KB, 0 = unlimited) = %d",roster_pool_kb);
+    fprintf(fpt5,"\n Roster pool size per employee = %d",roster_pool_target);
+    fprintf(fpt5,"\n Roster pool time budget per employee (s, 0 = unlimited) = %g",roster_pool_seconds);
+    fprintf(fpt5,"\n Roster pool cache = %s",pool_cache_file() != NULL ? pool_cache_file() : "disabled");
     /*fprintf(fpt5,"\n Number of constraints = %d",ncon);
     fprintf(fpt5,"\n Number of real variables = %d",nreal);
     if (nreal!=0)
@@ -359,11 +466,13 @@ int main (int argc, char **argv)
     printf("\n Memory allocation for parent population done \n");
     allocate_memory_pop (child_pop, popsize);
     printf("\n Memory allocation for child population done \n");
-    allocate_memory_pop (mixed_pop, 2*popsize);
+    allocate_shell_pop (mixed_pop, 2*popsize);
     printf("\n Memory allocation for mixed population done \n");
+    printf("\n Population arena: %zu bytes per individual, %zu bytes in total \n",
+           individual_block_size(), 2 * (size_t)popsize * individual_block_size());
     randomize();
     double time_counter = 0;
-    time_counter = clock();
+    time_counter = wall_seconds();
     printf("\n Performing initialization \n");
     initialize_pop (parent_pop, pi);
     printf("\n Initialization done \n");
@@ -374,7 +483,7 @@ int main (int argc, char **argv)
 
     printIndividual(parent_pop[0].ind, pi);
 
-    double time_init = clock() - time_counter;
+    double time_init = wall_seconds() - time_counter;
     
     printf("\n Initialization done, now performing first generation\n");
 
@@ -388,11 +497,12 @@ int main (int argc, char **argv)
     //check feasibilit on each employee
     emp_assign current_employee;
     current_employee.emp_id=2;
+    current_employee.table=&seq_table;
     current_employee.num_seqs=parent_pop->ind[0].num_seqs[2];
     current_employee.seqs=parent_pop->ind[0].seqs[2];
     current_employee.seq_start_day=parent_pop->ind[0].seq_start_days[2];
 
-    bool is_feasible=eval_employee_feasible(&current_employee, pi);
+    bool is_feasible=eval_employee_feasible(&current_employee, pi, default_eval_ctx);
 
     if(is_feasible){
         printf("Employee %d feasible\n",current_employee.emp_id);
@@ -443,13 +553,16 @@ int main (int argc, char **argv)
 
         decode_pop_sequences(child_pop, pi);
 
-        evaluate_pop(child_pop, pi);
+        int skipped_evaluations = evaluate_pop_dedup(parent_pop, child_pop, pi);
 
 
      
         merge (parent_pop, child_pop, mixed_pop);
 
-        fill_nondominated_sort (mixed_pop, parent_pop);
+        int mixed_duplicates = mark_duplicates(mixed_pop, 2*popsize);
+        fprintf(fpt8,"%d\t%d\t%d\n", i, skipped_evaluations, mixed_duplicates);
+
+        fill_nondominated_sort (mixed_pop, parent_pop, child_pop);
 
         current_gen = i;
 
@@ -509,6 +622,7 @@ int main (int argc, char **argv)
         fprintf(fpt5,"\n Number of crossover of binary variable = %d",nbincross);
         fprintf(fpt5,"\n Number of mutation of binary variable = %d",nbinmut);
     }
+    report_roster_cache(fpt5);
     //report solution as data 
     //get instance name
     char * instance_name = strrchr(instance_route, '/');
@@ -533,6 +647,7 @@ int main (int argc, char **argv)
     fflush(fpt5);
     fflush(fpt6);
     fflush(fpt7);
+    fflush(fpt8);
     fclose(fpt1);
     fclose(fpt2);
     fclose(fpt3);
@@ -540,6 +655,7 @@ int main (int argc, char **argv)
     fclose(fpt5);
     fclose(fpt6);
     fclose(fpt7);
+    fclose(fpt8);
     individual *best_obj0_ind = &parent_pop->ind[0];
     individual *best_obj1_ind = &parent_pop->ind[0];
 
@@ -568,16 +684,26 @@ int main (int argc, char **argv)
     }
     deallocate_memory_pop (parent_pop, popsize);
     deallocate_memory_pop (child_pop, popsize);
-    deallocate_memory_pop (mixed_pop, 2*popsize);
+    deallocate_shell_pop (mixed_pop);
     free (parent_pop);
     free (child_pop);
     free (mixed_pop);
+    threadpool_destroy ();
+    deallocate_eval_context (default_eval_ctx);
+    for (int e = 0; e < pi->num_employees; e++)
+    {
+        roster_pool_free (&employees_pool[e]);
+    }
+    free (employees_pool);
+    pool_cache_release ();
+    free_seq_indexes ();
+    free (num_sequences_pool_emp);
+    seq_table_free (&seq_table);
     printf("\n Routine successfully exited \n");
     
-    time_counter = clock() - time_counter;
-    double execution_time = time_counter/CLOCKS_PER_SEC;
+    double execution_time = wall_seconds() - time_counter;
     printf("\n Time taken = %f seconds\n", execution_time);
-    printf("\n Time taken for initialization = %f\n", time_init/CLOCKS_PER_SEC);
+    printf("\n Time taken for initialization = %f\n", time_init);
 
 
     
@@ -0,0 +1,322 @@
+/* On-disk cache of the feasible roster pools (see initialize_pop). The pools only
+   depend on the instance, the memory cap and the roster_pool_target, so the
+   first run of an instance writes them to a binary file and later runs map that
+   file read-only. Pools stopped by the roster_pool_seconds budget depend on the
+   load of the host and are not written, so the budget is not part of the key:
+   the rosters point straight into the mapping and concurrent runs of the same
+   instance share its pages through the page cache.
+
+   File layout (native byte order, every section 8-byte aligned):
+     pool_cache_header
+     int32  seq_offset[num_sequences + 1]     sequences of seq_table, in id order
+     uint8  seq_shifts[seq_offset[num_sequences]]
+     pool_cache_emp  emps[num_employees]
+     per employee: int32 start[count + 1], uint32 seqs[entries], uint16 days[entries] */
+
+# define _POSIX_C_SOURCE 200809L
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+
+# include "global.h"
+
+# define POOL_CACHE_MAGIC "ESSPPOOL"
+# define POOL_CACHE_VERSION 5
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t key;
+    int32_t num_employees;
+    int32_t horizon_length;
+    int32_t num_shifts;
+    int32_t num_sequences;
+    int64_t roster_pool_max_bytes;
+    int64_t roster_pool_target;
+} pool_cache_header;
+
+typedef struct {
+    int32_t count;
+    int32_t entries;
+    int32_t full;
+    int32_t pad;
+} pool_cache_emp;
+
+static char *pool_cache_path = NULL;   // Cache file of this run (NULL = no cache)
+static uint64_t pool_cache_key = 0;
+static void *mapping = NULL;
+static size_t mapping_bytes = 0;
+
+static size_t align8 (size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+static uint64_t fnv_update (uint64_t h, const void *data, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* Key of the cache: the instance file contents plus everything else the pools
+   are generated from. Returns 0 if the instance cannot be read */
+static uint64_t instance_key (const char *instance_path)
+{
+    FILE *f = fopen(instance_path, "rb");
+    if (f == NULL) return 0;
+
+    uint64_t h = 0xcbf29ce484222325ULL;
+    unsigned char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        h = fnv_update(h, buf, n);
+    }
+    fclose(f);
+
+    uint32_t version = POOL_CACHE_VERSION;
+    int64_t cap = roster_pool_max_bytes;
+    int64_t target = roster_pool_target;
+    double generator_seed = ROSTER_POOL_SEED;
+    h = fnv_update(h, &version, sizeof(version));
+    h = fnv_update(h, &cap, sizeof(cap));
+    h = fnv_update(h, &target, sizeof(target));
+    h = fnv_update(h, &generator_seed, sizeof(generator_seed));
+    return h ? h : 1;
+}
+
+/* Uses dir/<instance name>-<key>.pool as the cache of this run. Must be called
+   after the roster_pool_* parameters are set; dir NULL or "0" disables the cache */
+void pool_cache_configure (const char *dir, const char *instance_path)
+{
+    free(pool_cache_path);
+    pool_cache_path = NULL;
+    if (dir == NULL || dir[0] == '\0' || strcmp(dir, "0") == 0) return;
+
+    pool_cache_key = instance_key(instance_path);
+    if (pool_cache_key == 0) return;
+
+    const char *name = strrchr(instance_path, '/');
+    name = (name != NULL) ? name + 1 : instance_path;
+    size_t len = strlen(dir) + strlen(name) + 32;
+    pool_cache_path = (char *)malloc(len);
+    if (pool_cache_path == NULL) {
+        fprintf(stderr, "Memory allocation failed for pool cache path.\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(pool_cache_path, len, "%s/%s-%016llx.pool", dir, name, (unsigned long long)pool_cache_key);
+}
+
+const char *pool_cache_file (void)
+{
+    return pool_cache_path;
+}
+
+/* Maps the cache file and points employees_pool (already allocated) into it;
+   the sequences are interned into seq_table, which must be empty, with their
+   original ids. Returns 0 if there is no usable cache file (it is then rebuilt
+   and overwritten) */
+int pool_cache_load (problem_instance *pi)
+{
+    int num_emps = pi->num_employees;
+
+    if (pool_cache_path == NULL) return 0;
+    int fd = open(pool_cache_path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(pool_cache_header)) {
+        close(fd);
+        return 0;
+    }
+    size_t bytes = (size_t)st.st_size;
+    void *map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const char *base = (const char *)map;
+    const pool_cache_header *h = (const pool_cache_header *)base;
+    if (memcmp(h->magic, POOL_CACHE_MAGIC, 8) != 0 || h->version != POOL_CACHE_VERSION ||
+        h->header_bytes != sizeof(pool_cache_header) || h->key != pool_cache_key ||
+        h->num_employees != num_emps || h->horizon_length != pi->horizon_length ||
+        h->num_shifts != pi->num_shifts || h->roster_pool_max_bytes != roster_pool_max_bytes ||
+        h->roster_pool_target != roster_pool_target ||
+        h->num_sequences < 0 || seq_table.count != 0) {
+        munmap(map, bytes);
+        return 0;
+    }
+
+    /* Comprobar que todas las secciones caben en el archivo antes de usarlas */
+    int num_sequences = h->num_sequences;
+    size_t pos = align8(sizeof(pool_cache_header));
+    const int32_t *offset = (const int32_t *)(base + pos);
+    pos = align8(pos + (size_t)(num_sequences + 1) * sizeof(int32_t));
+    if (pos > bytes || offset[0] != 0) goto invalid;
+    for (int id = 0; id < num_sequences; id++) {
+        int length = offset[id + 1] - offset[id];
+        if (length <= 0 || length > pi->horizon_length) goto invalid;
+    }
+    const uint8_t *shifts = (const uint8_t *)(base + pos);
+    pos = align8(pos + (size_t)offset[num_sequences]);
+    const pool_cache_emp *emps = (const pool_cache_emp *)(base + pos);
+    pos = align8(pos + (size_t)num_emps * sizeof(pool_cache_emp));
+    if (pos > bytes) goto invalid;
+    for (int i = 0; i < offset[num_sequences]; i++) {
+        if (shifts[i] == 0 || shifts[i] >= pi->num_shifts) goto invalid;
+    }
+    size_t emps_end = pos;
+    for (int e = 0; e < num_emps; e++) {
+        if (emps[e].count < 0 || emps[e].entries < 0) goto invalid;
+        const int32_t *start = (const int32_t *)(base + pos);
+        pos = align8(pos + (size_t)(emps[e].count + 1) * sizeof(int32_t));
+        const uint32_t *seqs = (const uint32_t *)(base + pos);
+        pos = align8(pos + (size_t)emps[e].entries * sizeof(uint32_t));
+        const uint16_t *days = (const uint16_t *)(base + pos);
+        pos = align8(pos + (size_t)emps[e].entries * sizeof(uint16_t));
+        if (pos > bytes) goto invalid;
+        if (start[0] != 0 || start[emps[e].count] != emps[e].entries) goto invalid;
+        for (int r = 0; r < emps[e].count; r++) {
+            if (start[r] > start[r + 1]) goto invalid;
+        }
+        for (int k = 0; k < emps[e].entries; k++) {
+            if (seqs[k] >= (uint32_t)num_sequences || days[k] >= pi->horizon_length) goto invalid;
+        }
+    }
+    if (pos != bytes) goto invalid;
+
+    int *buf = (int *)malloc((pi->horizon_length + 1) * sizeof(int));
+    if (buf == NULL) {
+        fprintf(stderr, "Memory allocation failed for pool cache.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int id = 0; id < num_sequences; id++) {
+        int length = offset[id + 1] - offset[id];
+        for (int i = 0; i < length; i++) buf[i] = shifts[offset[id] + i];
+        if (seq_table_intern(&seq_table, pi, buf, length) != (seq_id)id) {
+            fprintf(stderr, "Error: roster pool cache %s is corrupt, delete it and run again.\n", pool_cache_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(buf);
+
+    pos = emps_end;
+    for (int e = 0; e < num_emps; e++) {
+        roster_pool *rp = &employees_pool[e];
+        roster_pool_free(rp);
+        rp->count = emps[e].count;
+        rp->capacity = emps[e].count;
+        rp->entries_capacity = emps[e].entries;
+        rp->full = emps[e].full;
+        rp->mapped = 1;
+        rp->start = (int *)(base + pos);
+        pos = align8(pos + (size_t)(rp->count + 1) * sizeof(int32_t));
+        rp->seqs = (seq_id *)(base + pos);
+        pos = align8(pos + (size_t)emps[e].entries * sizeof(uint32_t));
+        rp->days = (uint16_t *)(base + pos);
+        pos = align8(pos + (size_t)emps[e].entries * sizeof(uint16_t));
+    }
+
+    mapping = map;
+    mapping_bytes = bytes;
+    return 1;
+
+invalid:
+    fprintf(stderr, "Warning: ignoring invalid roster pool cache %s\n", pool_cache_path);
+    munmap(map, bytes);
+    return 0;
+}
+
+static void write_section (FILE *f, const void *data, size_t n, size_t *pos)
+{
+    static const char zeros[8] = {0};
+    if (n > 0 && fwrite(data, 1, n, f) != n) return;
+    *pos += n;
+    size_t pad = align8(*pos) - *pos;
+    if (pad > 0) fwrite(zeros, 1, pad, f);
+    *pos += pad;
+}
+
+/* Writes employees_pool and seq_table to the cache file. The file is written
+   under a temporary name and renamed, so concurrent runs never see half of it */
+void pool_cache_save (problem_instance *pi)
+{
+    int num_emps = pi->num_employees;
+    if (pool_cache_path == NULL) return;
+
+    char *dir = strdup(pool_cache_path);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        mkdir(dir, 0777);
+    }
+    free(dir);
+
+    size_t tmp_len = strlen(pool_cache_path) + 32;
+    char *tmp = (char *)malloc(tmp_len);
+    snprintf(tmp, tmp_len, "%s.%ld.tmp", pool_cache_path, (long)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Warning: could not write roster pool cache %s (%s)\n", tmp, strerror(errno));
+        free(tmp);
+        return;
+    }
+
+    pool_cache_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, POOL_CACHE_MAGIC, 8);
+    h.version = POOL_CACHE_VERSION;
+    h.header_bytes = sizeof(pool_cache_header);
+    h.key = pool_cache_key;
+    h.num_employees = num_emps;
+    h.horizon_length = pi->horizon_length;
+    h.num_shifts = pi->num_shifts;
+    h.num_sequences = seq_table.count;
+    h.roster_pool_max_bytes = roster_pool_max_bytes;
+    h.roster_pool_target = roster_pool_target;
+
+    size_t pos = 0;
+    int32_t empty_offset = 0;
+    write_section(f, &h, sizeof(h), &pos);
+    write_section(f, seq_table.count > 0 ? seq_table.offset : &empty_offset,
+                  (size_t)(seq_table.count + 1) * sizeof(int32_t), &pos);
+    write_section(f, seq_table.shifts, seq_table.count > 0 ? (size_t)seq_table.offset[seq_table.count] : 0, &pos);
+
+    pool_cache_emp *emps = (pool_cache_emp *)calloc(num_emps, sizeof(pool_cache_emp));
+    for (int e = 0; e < num_emps; e++) {
+        emps[e].count = employees_pool[e].count;
+        emps[e].entries = employees_pool[e].start[employees_pool[e].count];
+        emps[e].full = employees_pool[e].full;
+    }
+    write_section(f, emps, (size_t)num_emps * sizeof(pool_cache_emp), &pos);
+    for (int e = 0; e < num_emps; e++) {
+        roster_pool *rp = &employees_pool[e];
+        write_section(f, rp->start, (size_t)(rp->count + 1) * sizeof(int32_t), &pos);
+        write_section(f, rp->seqs, (size_t)emps[e].entries * sizeof(uint32_t), &pos);
+        write_section(f, rp->days, (size_t)emps[e].entries * sizeof(uint16_t), &pos);
+    }
+    free(emps);
+
+    if (ferror(f) | fclose(f) || rename(tmp, pool_cache_path) != 0) {
+        fprintf(stderr, "Warning: could not write roster pool cache %s\n", pool_cache_path);
+        remove(tmp);
+    }
+    free(tmp);
+}
+
+void pool_cache_release (void)
+{
+    free(pool_cache_path);
+    pool_cache_path = NULL;
+    if (mapping != NULL) munmap(mapping, mapping_bytes);
+    mapping = NULL;
+    mapping_bytes = 0;
+}
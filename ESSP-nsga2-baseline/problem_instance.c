@@ -14,7 +14,7 @@ void preferenceIndividual(individual *ind, problem_instance *pi, int print) {
     int total_preference = 0;
     for (int i = 0; i < pi->horizon_length; i++) {
         for (int j = 0; j < pi->num_employees; j++) {
-            int assigned_shift = ind->xreal[i * pi->num_employees + j];
+            int assigned_shift = get_cell(ind, pi, j, i);
             
             // Check shift on requests
             for (int s = 0; s < pi->num_shifts; s++) {
@@ -64,7 +64,7 @@ void coveringIndividual(individual *ind, problem_instance *pi, int print){
             shift_ammount[j] = 0;
         }
         for(int j = 0; j < pi->num_employees; j++){
-            int shift = ind->xreal[i * pi->num_employees + j];
+            int shift = get_cell(ind, pi, j, i);
             if (shift != 0)
             {
                 shift_ammount[shift]++;
@@ -110,7 +110,7 @@ void printIndividual(individual *ind, problem_instance *pi) {
     for (int j = 0; j < pi->num_employees; j++) {
         printf("%s", pi->employees[j].name);
         for (int i = 0; i < pi->horizon_length; i++) {
-            printf("\t%s", pi->shifts[ind->xreal[i * pi->num_employees + j]].name);
+            printf("\t%s", pi->shifts[get_cell(ind, pi, j, i)].name);
         }
         printf("\n");
     }
@@ -8,53 +8,34 @@
 # include "rand.h"
 
 double seed;
-double oldrand[55];
-int jrand;
+rand_stream global_rand;
+
+static void stream_advance (rand_stream *rs);
 
 /* Get seed number for random and start it up */
 void randomize()
 {
-    int j1;
-    for(j1=0; j1<=54; j1++)
-    {
-        oldrand[j1] = 0.0;
-    }
-    jrand=0;
-    warmup_random (seed);
+    stream_init (&global_rand, seed);
     return;
 }
 
 /* Get randomize off and running */
 void warmup_random (double seed)
 {
-    int j1, ii;
-    double new_random, prev_random;
-    oldrand[54] = seed;
-    new_random = 0.000000001;
-    prev_random = seed;
-    for(j1=1; j1<=54; j1++)
-    {
-        ii = (21*j1)%54;
-        oldrand[ii] = new_random;
-        new_random = prev_random-new_random;
-        if(new_random<0.0)
-        {
-            new_random += 1.0;
-        }
-        prev_random = oldrand[ii];
-    }
-    advance_random ();
-    advance_random ();
-    advance_random ();
-    jrand = 0;
-    return;
+    stream_init (&global_rand, seed);
 }
 
 /* Create next batch of 55 random numbers */
 void advance_random ()
+{
+    stream_advance (&global_rand);
+}
+
+static void stream_advance (rand_stream *rs)
 {
     int j1;
     double new_random;
+    double *oldrand = rs->oldrand;
     for(j1=0; j1<24; j1++)
     {
         new_random = oldrand[j1]-oldrand[j1+31];
@@ -78,17 +59,64 @@ void advance_random ()
 /* Fetch a single random number between 0.0 and 1.0 */
 double randomperc()
 {
-    jrand++;
-    if(jrand>=55)
-    {
-        jrand = 1;
-        advance_random();
-    }
-    return((double)oldrand[jrand]);
+    return stream_randomperc (&global_rand);
 }
 
 /* Fetch a single random integer between low and high including the bounds */
 int rnd (int low, int high)
+{
+    return stream_rnd (&global_rand, low, high);
+}
+
+/* Fetch a single random real number between low and high including the bounds */
+double rndreal (double low, double high)
+{
+    return (low + (high-low)*randomperc());
+}
+
+/* Starts stream rs from stream_seed (in (0,1)), as randomize does for the global one */
+void stream_init (rand_stream *rs, double stream_seed)
+{
+    int j1, ii;
+    double new_random, prev_random;
+    double *oldrand = rs->oldrand;
+    for(j1=0; j1<=54; j1++)
+    {
+        oldrand[j1] = 0.0;
+    }
+    oldrand[54] = stream_seed;
+    new_random = 0.000000001;
+    prev_random = stream_seed;
+    for(j1=1; j1<=54; j1++)
+    {
+        ii = (21*j1)%54;
+        oldrand[ii] = new_random;
+        new_random = prev_random-new_random;
+        if(new_random<0.0)
+        {
+            new_random += 1.0;
+        }
+        prev_random = oldrand[ii];
+    }
+    stream_advance (rs);
+    stream_advance (rs);
+    stream_advance (rs);
+    rs->jrand = 0;
+    return;
+}
+
+double stream_randomperc (rand_stream *rs)
+{
+    rs->jrand++;
+    if(rs->jrand>=55)
+    {
+        rs->jrand = 1;
+        stream_advance (rs);
+    }
+    return(rs->oldrand[rs->jrand]);
+}
+
+int stream_rnd (rand_stream *rs, int low, int high)
 {
     int res;
     if (low >= high)
@@ -97,7 +125,7 @@ int rnd (int low, int high)
     }
     else
     {
-        res = low + (randomperc()*(high-low+1));
+        res = low + (stream_randomperc(rs)*(high-low+1));
         if (res > high)
         {
             res = high;
@@ -106,8 +134,11 @@ int rnd (int low, int high)
     return (res);
 }
 
-/* Fetch a single random real number between low and high including the bounds */
-double rndreal (double low, double high)
+/* Seed in (0,1) for the stream of task index, derived from base_seed so that
+   every task gets the same numbers whatever thread runs it */
+double derived_seed (double base_seed, int index)
 {
-    return (low + (high-low)*randomperc());
+    double s = fmod(base_seed + 0.6180339887498949 * (index + 1), 1.0);
+    if (s <= 0.0) s += 0.5;
+    return s;
 }
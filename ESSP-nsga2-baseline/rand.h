@@ -3,10 +3,17 @@
 # ifndef _RAND_H_
 # define _RAND_H_
 
+/* State of one stream of the random number generator */
+typedef struct rand_stream
+{
+    double oldrand[55];
+    int jrand;
+}
+rand_stream;
+
 /* Variable declarations for the random number generator */
 extern double seed;
-extern double oldrand[55];
-extern int jrand;
+extern rand_stream global_rand;  // Stream used by randomperc, rnd and rndreal
 
 /* Function declarations for the random number generator */
 void randomize(void);
@@ -16,4 +23,10 @@ double randomperc(void);
 int rnd (int low, int high);
 double rndreal (double low, double high);
 
+/* Independent streams (same generator), e.g. one per task of a parallel loop */
+void stream_init (rand_stream *rs, double stream_seed);
+double stream_randomperc (rand_stream *rs);
+int stream_rnd (rand_stream *rs, int low, int high);
+double derived_seed (double base_seed, int index);
+
 # endif
@@ -98,6 +98,9 @@ int readInputFile(const char* filePath, problem_instance *pi) {
 
     readCoverWeights(fh, pi);
 
+    buildPreferenceCosts(pi);
+
+    buildConstraintTables(pi);
 
     nreal = pi->num_employees * pi->horizon_length;
     nbin = 0;
@@ -111,10 +114,15 @@ int readInputFile(const char* filePath, problem_instance *pi) {
     //     min_realvar[i] = 0;
     // }
 
-    //days off 
-    for (int i = 0; i < pi->horizon_length; i++)
+    if (pi->num_shifts > MAX_SHIFT_TYPES) {
+        printf("Error: %d shift types, at most %d are supported.\n", pi->num_shifts - 1, MAX_SHIFT_TYPES - 1);
+        exit(1);
+    }
+
+    //days off (bounds are stored employee-major, like xreal)
+    for (int j = 0; j < pi->num_employees; j++)
     {
-        for (int j = 0; j < pi->num_employees; j++)
+        for (int i = 0; i < pi->horizon_length; i++)
         {
             //days off
             if (pi->employees[j].num_days_off > 0)
@@ -123,21 +131,21 @@ int readInputFile(const char* filePath, problem_instance *pi) {
                 {
                     if (i == pi->employees[j].days_off[k])
                     {
-                        max_realvar[i * pi->num_employees + j] = 0;
-                        min_realvar[i * pi->num_employees + j] = 0;
+                        max_realvar[j * pi->horizon_length + i] = 0;
+                        min_realvar[j * pi->horizon_length + i] = 0;
                         break;
                     }
                     else
                     {
-                        max_realvar[i * pi->num_employees + j] = pi->num_shifts-1;
-                        min_realvar[i * pi->num_employees + j] = 0;
+                        max_realvar[j * pi->horizon_length + i] = pi->num_shifts-1;
+                        min_realvar[j * pi->horizon_length + i] = 0;
                     }
                 }
             }
             else
             {
-                max_realvar[i * pi->num_employees + j] = pi->num_shifts-1;
-                min_realvar[i * pi->num_employees + j] = 0;
+                max_realvar[j * pi->horizon_length + i] = pi->num_shifts-1;
+                min_realvar[j * pi->horizon_length + i] = 0;
             }
         }
     }
@@ -149,6 +157,86 @@ int readInputFile(const char* filePath, problem_instance *pi) {
     return 1;
 }
 
+/* Precomputes, for every (employee, day, shift), the preference cost of that
+   assignment: the off-request of the assigned shift plus the on-requests of
+   every other shift */
+void buildPreferenceCosts(problem_instance *pi) {
+    int num_shifts = pi->num_shifts;
+    pi->pref_cost = malloc(pi->num_employees * pi->horizon_length * num_shifts * sizeof(int));
+    if (!pi->pref_cost) {
+        printf("Error: Memory allocation failed for preference costs.\n");
+        exit(1);
+    }
+
+    for (int e = 0; e < pi->num_employees; e++) {
+        for (int d = 0; d < pi->horizon_length; d++) {
+            int total_on = 0;
+            for (int s = 0; s < num_shifts; s++) {
+                total_on += pi->shift_on_requests[e][d][s];
+            }
+            int *cost = &pi->pref_cost[(e * pi->horizon_length + d) * num_shifts];
+            for (int s = 0; s < num_shifts; s++) {
+                cost[s] = total_on - pi->shift_on_requests[e][d][s] + pi->shift_off_requests[e][d][s];
+            }
+        }
+    }
+
+    // Running cost of leaving the employee without shift, used by the sequence evaluator
+    pi->pref_off_prefix = malloc(pi->num_employees * (pi->horizon_length + 1) * sizeof(int));
+    if (!pi->pref_off_prefix) {
+        printf("Error: Memory allocation failed for preference costs.\n");
+        exit(1);
+    }
+    for (int e = 0; e < pi->num_employees; e++) {
+        int *prefix = &pi->pref_off_prefix[e * (pi->horizon_length + 1)];
+        prefix[0] = 0;
+        for (int d = 0; d < pi->horizon_length; d++) {
+            prefix[d + 1] = prefix[d] + pref_cost_at(pi, e, d, 0);
+        }
+    }
+}
+
+/* Builds the shift x shift incompatibility bit matrix (R3) and the
+   horizon-length days-off bitset (and its running count) of every employee (R1) */
+void buildConstraintTables(problem_instance *pi) {
+    pi->incompat_words = (pi->num_shifts + 63) / 64;
+    pi->incompat_bits = calloc(pi->num_shifts * pi->incompat_words, sizeof(uint64_t));
+    pi->days_off_words = (pi->horizon_length + 63) / 64;
+    pi->days_off_bits = calloc(pi->num_employees * pi->days_off_words, sizeof(uint64_t));
+    if (!pi->incompat_bits || !pi->days_off_bits) {
+        printf("Error: Memory allocation failed for constraint tables.\n");
+        exit(1);
+    }
+
+    for (int a = 0; a < pi->num_shifts; a++) {
+        for (int k = 0; k < pi->shifts[a].num_incompatible_shifts; k++) {
+            int b = pi->shifts[a].incompatible_shifts[k];
+            pi->incompat_bits[a * pi->incompat_words + (b >> 6)] |= (uint64_t)1 << (b & 63);
+        }
+    }
+
+    for (int e = 0; e < pi->num_employees; e++) {
+        for (int k = 0; k < pi->employees[e].num_days_off; k++) {
+            int d = pi->employees[e].days_off[k];
+            if (d < 0 || d >= pi->horizon_length) continue;
+            pi->days_off_bits[e * pi->days_off_words + (d >> 6)] |= (uint64_t)1 << (d & 63);
+        }
+    }
+
+    pi->days_off_prefix = malloc(pi->num_employees * (pi->horizon_length + 1) * sizeof(int));
+    if (!pi->days_off_prefix) {
+        printf("Error: Memory allocation failed for constraint tables.\n");
+        exit(1);
+    }
+    for (int e = 0; e < pi->num_employees; e++) {
+        int *prefix = &pi->days_off_prefix[e * (pi->horizon_length + 1)];
+        prefix[0] = 0;
+        for (int d = 0; d < pi->horizon_length; d++) {
+            prefix[d + 1] = prefix[d] + is_day_off(pi, e, d);
+        }
+    }
+}
+
 void readEmployees(FILE *f, problem_instance *pi) {
     rewind(f);
     char line[MAX_LINE_LENGTH];
@@ -28,7 +28,7 @@ void report_pop (population *pop, FILE *fpt)
         {
             for (j=0; j<nreal; j++)
             {
-                fprintf(fpt,"%d\t",pop->ind[i].xreal[j]);
+                fprintf(fpt,"%d\t",pop->ind[i].xreal[day_major_index(pi, j)]);
             }
         }
         if (nbin!=0)
@@ -74,7 +74,7 @@ void report_feasible (population *pop, FILE *fpt)
             {
                 for (j=0; j<nreal; j++)
                 {
-                    fprintf(fpt,"%d\t",pop->ind[i].xreal[j]);
+                    fprintf(fpt,"%d\t",pop->ind[i].xreal[day_major_index(pi, j)]);
                 }
             }
             if (nbin!=0)
@@ -171,11 +171,11 @@ void export_pop_full(population *pop, FILE *fpt, problem_instance *pi){
             {
             if (k == 0)
             {
-                fprintf(fpt, "%s", pi->shifts[pop->ind[i].xreal[k * pi->num_employees + j]].name);
+                fprintf(fpt, "%s", pi->shifts[get_cell(&pop->ind[i], pi, j, k)].name);
             }
             else
             {
-                fprintf(fpt, "\t%s", pi->shifts[pop->ind[i].xreal[k * pi->num_employees + j]].name);
+                fprintf(fpt, "\t%s", pi->shifts[get_cell(&pop->ind[i], pi, j, k)].name);
             }
             }
             fprintf(fpt, "\n");
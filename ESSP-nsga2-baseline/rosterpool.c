@@ -0,0 +1,110 @@
+/* Pools of feasible rosters per employee, stored in compressed sparse row form
+   (see roster_pool in global.h) */
+
+# include <stdio.h>
+# include <stdlib.h>
+
+# include "global.h"
+
+roster_pool *employees_pool = NULL;
+long roster_pool_max_bytes = 0; // Memory cap of each employee's pool (0 = unlimited)
+int roster_pool_target = 2000;  // Distinct rosters drawn for each employee's pool
+double roster_pool_seconds = 0; // Wall-clock budget to build each employee's pool (0 = unlimited)
+
+void roster_pool_init (roster_pool *rp)
+{
+    rp->count = 0;
+    rp->capacity = 0;
+    rp->entries_capacity = 0;
+    rp->full = 0;
+    rp->mapped = 0;
+    rp->start = (int *)malloc(sizeof(int));
+    if (rp->start == NULL) {
+        fprintf(stderr, "Memory allocation failed for roster pool.\n");
+        exit(EXIT_FAILURE);
+    }
+    rp->start[0] = 0;
+    rp->seqs = NULL;
+    rp->days = NULL;
+}
+
+/* Bytes allocated by the pool */
+size_t roster_pool_bytes (roster_pool *rp)
+{
+    return (size_t)(rp->capacity + 1) * sizeof(int) +
+           (size_t)rp->entries_capacity * (sizeof(seq_id) + sizeof(uint16_t));
+}
+
+/* Doubles *capacity (at least to needed) unless that takes the pool over the
+   memory cap, in which case it grows to whatever still fits. other_bytes is
+   what the rest of the pool uses. Returns 0 if not even needed fits */
+static int grow_capacity (int *capacity, int needed, size_t elem_bytes, size_t other_bytes)
+{
+    long new_capacity = (*capacity == 0) ? 1024 : 2L * *capacity;
+    if (new_capacity < needed) new_capacity = needed;
+    if (roster_pool_max_bytes > 0) {
+        long fit = ((long)roster_pool_max_bytes - (long)other_bytes) / (long)elem_bytes;
+        if (new_capacity > fit) new_capacity = fit;
+        if (new_capacity < needed) return 0;
+    }
+    *capacity = (int)new_capacity;
+    return 1;
+}
+
+/* Appends a roster of n sequences (seqs[k] starting at days[k]). Returns 0 and
+   marks the pool as full if it does not fit in roster_pool_max_bytes */
+int roster_pool_add (roster_pool *rp, const seq_id *seqs, const int *days, int n)
+{
+    int entries = rp->start[rp->count];
+
+    if (rp->full) return 0;
+    if (rp->count + 1 > rp->capacity) {
+        size_t other = (size_t)rp->entries_capacity * (sizeof(seq_id) + sizeof(uint16_t)) + sizeof(int);
+        if (!grow_capacity(&rp->capacity, rp->count + 1, sizeof(int), other)) {
+            rp->full = 1;
+            return 0;
+        }
+        rp->start = (int *)realloc(rp->start, (rp->capacity + 1) * sizeof(int));
+    }
+    if (entries + n > rp->entries_capacity) {
+        size_t other = (size_t)(rp->capacity + 1) * sizeof(int);
+        if (!grow_capacity(&rp->entries_capacity, entries + n, sizeof(seq_id) + sizeof(uint16_t), other)) {
+            rp->full = 1;
+            return 0;
+        }
+        rp->seqs = (seq_id *)realloc(rp->seqs, rp->entries_capacity * sizeof(seq_id));
+        rp->days = (uint16_t *)realloc(rp->days, rp->entries_capacity * sizeof(uint16_t));
+    }
+    if (rp->start == NULL || (rp->entries_capacity > 0 && (rp->seqs == NULL || rp->days == NULL))) {
+        fprintf(stderr, "Memory allocation failed for roster pool.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int k = 0; k < n; k++) {
+        if (days[k] < 0 || days[k] > UINT16_MAX) {
+            fprintf(stderr, "Error: start day %d out of range in roster pool.\n", days[k]);
+            exit(EXIT_FAILURE);
+        }
+        rp->seqs[entries + k] = seqs[k];
+        rp->days[entries + k] = (uint16_t)days[k];
+    }
+    rp->count++;
+    rp->start[rp->count] = entries + n;
+    return 1;
+}
+
+void roster_pool_free (roster_pool *rp)
+{
+    if (!rp->mapped) {
+        free(rp->start);
+        free(rp->seqs);
+        free(rp->days);
+    }
+    rp->mapped = 0;
+    rp->start = NULL;
+    rp->seqs = NULL;
+    rp->days = NULL;
+    rp->count = 0;
+    rp->capacity = 0;
+    rp->entries_capacity = 0;
+}
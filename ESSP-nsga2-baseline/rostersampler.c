@@ -0,0 +1,362 @@
+/* Uniform sampler of the feasible rosters of one employee (see roster_sampler in
+   global.h). A roster is a set of maximal work runs, each one a sequence of the
+   employee's implicit pool (seqpool.c), separated by off runs. Every constraint
+   of eval_employee_feasible except R2 only depends on where the runs start and
+   end and on how many minutes they take:
+     R1  runs do not cover the requested days off
+     R4  runs of min_consecutive_shifts..max_length days (the last one may be
+         shorter), off runs of at least min_consecutive_days_off before each run
+     R5  the weekends of a run are fixed by its first and last day
+     R7  the minutes add up over the runs
+   so a counting DP over (day, weekends used, minutes used) gives how many
+   rosters complete each state, and a roster is drawn front to back in O(H)
+   steps, each run with a sequence of the exact length and minutes chosen (a
+   seq_query with min_minutes == max_minutes). R2 (shifts of each type) is left
+   to the caller, which discards the rosters that break it.
+
+   The counts grow like (shifts)^H, so each day of the table is stored divided
+   by its largest entry and log_scale keeps the logarithm of that factor */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <math.h>
+
+# include "global.h"
+# include "rand.h"
+
+static inline double *sampler_layer (roster_sampler *rs, int d)
+{
+    return &rs->T[(size_t)d * rs->num_w * rs->num_m];
+}
+
+/* Weekends counted for a run of length days starting at day start: the
+   Saturdays it works, plus the one before if it starts on Sunday */
+static int run_weekends (int start, int length)
+{
+    int weekends = 0;
+    int from = (start % 7 == 6) ? start - 1 : start;
+    for (int day = from; day < start + length; day++) {
+        if (day % 7 == 5) weekends++;
+    }
+    return weekends;
+}
+
+/* True if a run of length days may start at day start */
+static inline int run_fits (roster_sampler *rs, int start, int length)
+{
+    if (length > rs->run_limit[start]) return 0;
+    return length >= rs->min_run || start + length == rs->horizon;
+}
+
+/* Weight of the state left after a run that ends the day before day end, with
+   w weekends and m units used, relative to exp(ref): the roster may stop there
+   (if it already has min_units) or go on with another run gap days later */
+static inline double after_run (roster_sampler *rs, int end, int w, int m, double ref)
+{
+    double v = (m >= rs->min_units) ? exp(-ref) : 0.0;
+    int next = end + rs->gap;
+    if (next < rs->horizon) {
+        v += sampler_layer(rs, next)[w * rs->num_m + m] * exp(rs->log_scale[next] - ref);
+    }
+    return v;
+}
+
+/* Total weight (relative to exp(ref)) of the rosters whose next run starts at
+   day start in state (w, m). If weights != NULL, weights[p] gets the share of
+   each (length, minutes) pair p */
+static double run_weights (roster_sampler *rs, int start, int w, int m, double ref, double *weights)
+{
+    double total = 0.0;
+    for (int length = 1; length <= rs->max_length; length++) {
+        int first = rs->pair_start[length], last = rs->pair_start[length + 1];
+        if (!run_fits(rs, start, length)) {
+            if (weights) for (int p = first; p < last; p++) weights[p] = 0.0;
+            continue;
+        }
+        int w2 = w + run_weekends(start, length);
+        for (int p = first; p < last; p++) {
+            int m2 = m + rs->pair_units[p];
+            double v = 0.0;
+            if (w2 < rs->num_w && m2 < rs->num_m) {
+                v = rs->pair_count[p] * after_run(rs, start + length, w2, m2, ref);
+            }
+            if (weights) weights[p] = v;
+            total += v;
+        }
+    }
+    return total;
+}
+
+/* Fills day d of the table from the days after it */
+static void build_layer (roster_sampler *rs, int d, double *runs, double *after)
+{
+    int num_w = rs->num_w, num_m = rs->num_m;
+    size_t cells = (size_t)num_w * num_m;
+    double ref = rs->log_scale[d + 1];
+
+    /* Estados alcanzables el día d: semanas y minutos de los días anteriores */
+    int w_hi = (d + 1) / 7;
+    if (w_hi > num_w - 1) w_hi = num_w - 1;
+    long m_hi = (long)d * rs->max_shift_units;
+    if (m_hi > num_m - 1) m_hi = num_m - 1;
+    long m_lo = rs->min_units - (long)(rs->horizon - d) * rs->max_shift_units;
+    if (m_lo < 0) m_lo = 0;
+
+    memset(runs, 0, cells * sizeof(double));
+    for (int length = 1; length <= rs->max_length; length++) {
+        if (!run_fits(rs, d, length)) continue;
+        int end = d + length;
+        int weekends = run_weekends(d, length);
+        if (weekends > num_w - 1) continue;
+
+        /* after_run(rs, end, w2, m2, ref) de todos los estados, con las escalas
+           calculadas una sola vez */
+        double stop = exp(-ref);
+        int next = end + rs->gap;
+        const double *later = (next < rs->horizon) ? sampler_layer(rs, next) : NULL;
+        double factor = later ? exp(rs->log_scale[next] - ref) : 0.0;
+        for (int w2 = weekends; w2 < num_w; w2++) {
+            double *row = &after[w2 * num_m];
+            for (int m2 = 0; m2 < num_m; m2++) {
+                row[m2] = (m2 >= rs->min_units) ? stop : 0.0;
+                if (later) row[m2] += later[w2 * num_m + m2] * factor;
+            }
+        }
+        for (int p = rs->pair_start[length]; p < rs->pair_start[length + 1]; p++) {
+            double c = rs->pair_count[p];
+            int u = rs->pair_units[p];
+            long hi = (m_hi < num_m - 1 - u) ? m_hi : num_m - 1 - u;
+            for (int w = 0; w <= w_hi && w + weekends < num_w; w++) {
+                double *row = &runs[w * num_m];
+                const double *next = &after[(w + weekends) * num_m + u];
+                for (long m = m_lo; m <= hi; m++) row[m] += c * next[m];
+            }
+        }
+    }
+
+    /* T(d) = S(d) + T(d + 1), normalizado por su mayor valor */
+    double *layer = sampler_layer(rs, d);
+    double largest = 0.0;
+    if (d + 1 < rs->horizon) {
+        const double *later = sampler_layer(rs, d + 1);
+        for (size_t k = 0; k < cells; k++) runs[k] += later[k];
+    }
+    for (size_t k = 0; k < cells; k++) {
+        if (runs[k] > largest) largest = runs[k];
+    }
+    if (largest > 0.0) {
+        rs->log_scale[d] = ref + log(largest);
+        for (size_t k = 0; k < cells; k++) layer[k] = runs[k] / largest;
+    } else {
+        rs->log_scale[d] = ref;
+        memset(layer, 0, cells * sizeof(double));
+    }
+}
+
+/* Builds the sampler of employee emp. Returns 0, with nothing allocated, if its
+   table would take more than ROSTER_SAMPLER_MAX_BYTES */
+int roster_sampler_build (roster_sampler *rs, problem_instance *pi, int emp)
+{
+    employee *e = &pi->employees[emp];
+    seq_length_index *idx = seq_index[emp];
+    int horizon = pi->horizon_length;
+
+    memset(rs, 0, sizeof(*rs));
+    rs->emp = emp;
+    rs->horizon = horizon;
+    rs->max_length = idx->max_length;
+    rs->min_run = e->min_consecutive_shifts;
+    rs->gap = (e->min_consecutive_days_off > 1) ? e->min_consecutive_days_off : 1;
+    rs->unit = idx->minute_unit;
+    rs->min_units = (e->min_total_minutes > 0) ? (e->min_total_minutes + rs->unit - 1) / rs->unit : 0;
+    rs->num_w = (e->max_weekends >= 0) ? e->max_weekends + 1 : 0;
+    rs->num_m = (e->max_total_minutes >= 0) ? e->max_total_minutes / rs->unit + 1 : 0;
+    rs->max_shift_units = 0;
+    for (int s = 1; s < idx->num_shifts; s++) {
+        if (idx->allowed[s] && idx->units[s] > rs->max_shift_units) rs->max_shift_units = idx->units[s];
+    }
+
+    double bytes = (double)horizon * rs->num_w * rs->num_m * sizeof(double);
+    if (bytes > ROSTER_SAMPLER_MAX_BYTES) return 0;
+
+    /* Secuencias de cada largo por minutos exactos (sin vecinos: hay descanso o
+       borde del horizonte a ambos lados) */
+    int max_units = (idx->max_units < rs->num_m - 1) ? idx->max_units : rs->num_m - 1;
+    int max_pairs = (rs->max_length + 1) * (max_units + 1);
+    rs->pair_start = (int *)malloc((rs->max_length + 2) * sizeof(int));
+    rs->pair_units = (int *)malloc((max_pairs > 0 ? max_pairs : 1) * sizeof(int));
+    rs->pair_count = (double *)malloc((max_pairs > 0 ? max_pairs : 1) * sizeof(double));
+    rs->run_limit = (int *)malloc((horizon + 1) * sizeof(int));
+    rs->log_scale = (double *)malloc((horizon + 1) * sizeof(double));
+    rs->T = (double *)calloc((size_t)horizon * rs->num_w * rs->num_m + 1, sizeof(double));
+    if (!rs->pair_start || !rs->pair_units || !rs->pair_count || !rs->run_limit || !rs->log_scale || !rs->T) {
+        fprintf(stderr, "Memory allocation failed for roster sampler (employee %d).\n", emp);
+        exit(EXIT_FAILURE);
+    }
+
+    int pairs = 0;
+    rs->pair_start[0] = rs->pair_start[1] = 0;
+    for (int length = 1; length <= rs->max_length; length++) {
+        seq_query q;
+        q.length = length;
+        q.prev_shift = 0;
+        q.next_shift = 0;
+        for (int u = 0; u <= max_units; u++) {
+            q.min_minutes = q.max_minutes = u * rs->unit;
+            int64_t c = seq_query_count(pi, idx, &q);
+            if (c == 0) continue;
+            rs->pair_units[pairs] = u;
+            rs->pair_count[pairs] = (double)c;
+            pairs++;
+        }
+        rs->pair_start[length + 1] = pairs;
+    }
+
+    rs->run_limit[horizon] = 0;
+    for (int d = horizon - 1; d >= 0; d--) {
+        rs->run_limit[d] = is_day_off(pi, emp, d) ? 0 : rs->run_limit[d + 1] + 1;
+        if (rs->run_limit[d] > rs->max_length) rs->run_limit[d] = rs->max_length;
+    }
+
+    rs->log_scale[horizon] = 0.0;
+    if (rs->num_w > 0 && rs->num_m > 0) {
+        size_t cells = (size_t)rs->num_w * rs->num_m;
+        double *runs = (double *)malloc(cells * sizeof(double));
+        double *after = (double *)malloc(cells * sizeof(double));
+        if (!runs || !after) {
+            fprintf(stderr, "Memory allocation failed for roster sampler (employee %d).\n", emp);
+            exit(EXIT_FAILURE);
+        }
+        for (int d = horizon - 1; d >= 0; d--) build_layer(rs, d, runs, after);
+        free(runs);
+        free(after);
+    } else {
+        for (int d = horizon - 1; d >= 0; d--) rs->log_scale[d] = 0.0;
+    }
+    return 1;
+}
+
+/* Picks the day the next run starts, or -1 to rest until the end of the
+   horizon, among the rosters whose next run starts at day first or later (or
+   at day 0 too, if from_zero) in state (w, m). Returns -2 if there are none */
+static int pick_start (roster_sampler *rs, rand_stream *rng, int first, int from_zero, int w, int m)
+{
+    int horizon = rs->horizon;
+    double ref = from_zero ? rs->log_scale[0] : (first < horizon) ? rs->log_scale[first] : 0.0;
+    double rest = (m >= rs->min_units) ? exp(-ref) : 0.0;
+    double at_zero = from_zero ? run_weights(rs, 0, w, m, ref, NULL) : 0.0;
+    double later = 0.0;
+    if (first < horizon) {
+        later = sampler_layer(rs, first)[w * rs->num_m + m] * exp(rs->log_scale[first] - ref);
+    }
+    double total = rest + at_zero + later;
+
+    /* Sin más partidas posibles el descanso puede quedar por debajo de exp(-ref) */
+    if (!(total > 0.0)) return (m >= rs->min_units) ? -1 : -2;
+    double r = stream_randomperc(rng) * total;
+    if (r < rest) return -1;
+    r -= rest;
+    if (r < at_zero || later <= 0.0) return 0;
+    r -= at_zero;
+
+    /* T(first) acumula las partidas de first en adelante: la elegida es la
+       primera cuyo resto T(start + 1) queda por debajo de r */
+    for (int start = first; start < horizon; start++) {
+        double beyond = 0.0;
+        if (start + 1 < horizon) {
+            beyond = sampler_layer(rs, start + 1)[w * rs->num_m + m] * exp(rs->log_scale[start + 1] - ref);
+        }
+        /* Por redondeo puede tocar una partida sin rosters: se sigue con la próxima */
+        if (r >= beyond && run_weights(rs, start, w, m, ref, NULL) > 0.0) return start;
+    }
+    return -2;
+}
+
+/* Draws a feasible roster (up to R2) of the employee, uniformly among all of
+   them: its sequences, interned in table t, go to seqs and their start days to
+   days. Returns the number of sequences, or -1 if the employee has no roster */
+int roster_sampler_draw (roster_sampler *rs, problem_instance *pi, sequence_table *t,
+                         rand_stream *rng, seq_id *seqs, int *days)
+{
+    int num_pairs = rs->pair_start[rs->max_length + 1];
+    double weights[num_pairs > 0 ? num_pairs : 1];
+    int n = 0, w = 0, m = 0;
+    int first = rs->gap;     // La primera secuencia empieza el día 0 o tras min_consecutive_days_off
+    int from_zero = 1;
+
+    if (rs->num_w == 0 || rs->num_m == 0) return -1;
+    for (;;) {
+        int start = pick_start(rs, rng, first, from_zero, w, m);
+        if (start == -1) break;
+        if (start == -2) return -1;
+
+        double total = run_weights(rs, start, w, m, rs->log_scale[start], weights);
+        double r = stream_randomperc(rng) * total;
+        int chosen = -1, length = 0;
+        for (int len = 1; len <= rs->max_length && chosen < 0; len++) {
+            for (int p = rs->pair_start[len]; p < rs->pair_start[len + 1]; p++) {
+                if (weights[p] <= 0.0) continue;
+                chosen = p;
+                length = len;
+                if (r < weights[p]) break;
+                r -= weights[p];
+                chosen = -1;
+            }
+        }
+        if (chosen < 0) {
+            /* Redondeo: el último par con peso */
+            for (int len = 1; len <= rs->max_length; len++) {
+                for (int p = rs->pair_start[len]; p < rs->pair_start[len + 1]; p++) {
+                    if (weights[p] > 0.0) {
+                        chosen = p;
+                        length = len;
+                    }
+                }
+            }
+            if (chosen < 0) return -1;
+        }
+
+        seq_query q;
+        q.length = length;
+        q.prev_shift = 0;
+        q.next_shift = 0;
+        q.min_minutes = q.max_minutes = rs->pair_units[chosen] * rs->unit;
+        int64_t count = seq_query_count(pi, seq_index[rs->emp], &q);
+        seqs[n] = seq_query_unrank(t, pi, rs->emp, &q, seq_random_below(count, rng));
+        days[n] = start;
+        n++;
+
+        w += run_weekends(start, length);
+        m += rs->pair_units[chosen];
+        first = start + length + rs->gap;
+        from_zero = 0;
+    }
+    return n;
+}
+
+/* Natural logarithm of the number of rosters the sampler draws from (before
+   R2), or -INFINITY if there are none */
+double roster_sampler_log_count (roster_sampler *rs)
+{
+    if (rs->num_w == 0 || rs->num_m == 0) return -INFINITY;
+    int first = rs->gap;
+    double ref = rs->log_scale[0];
+    double total = (rs->min_units <= 0) ? exp(-ref) : 0.0;
+    total += run_weights(rs, 0, 0, 0, ref, NULL);
+    if (first < rs->horizon) {
+        total += sampler_layer(rs, first)[0] * exp(rs->log_scale[first] - ref);
+    }
+    return (total > 0.0) ? ref + log(total) : -INFINITY;
+}
+
+void roster_sampler_free (roster_sampler *rs)
+{
+    free(rs->pair_start);
+    free(rs->pair_units);
+    free(rs->pair_count);
+    free(rs->run_limit);
+    free(rs->log_scale);
+    free(rs->T);
+    memset(rs, 0, sizeof(*rs));
+}
@@ -0,0 +1,423 @@
+/* Implicit per-employee pools of work sequences (see seq_length_index in global.h).
+   The sequences of an employee are the strings of 1..max_length shifts it may
+   work with no incompatible consecutive pair. A counting DP over (remaining
+   length, previous shift) gives how many there are of each length, and
+   seq_unrank builds the one of a given lexicographic rank, so the pool is never
+   enumerated: only the sequences actually drawn end up in seq_table.
+   The pool only depends on the shifts an employee may work and its maximum
+   length, so employees with the same contract signature share one index.
+   A second DP adds the minutes of the sequence and the shift it may end with
+   (given the shift worked the day after), so the sequences of a length that
+   fit between two neighbouring days within a minute budget (seq_query) are
+   counted and unranked directly instead of being filtered after the draw */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <pthread.h>
+
+# include "global.h"
+# include "rand.h"
+
+seq_length_index **seq_index;      // Per employee: the index of its contract class
+seq_length_index *seq_classes;     // One index per distinct contract signature
+int num_seq_classes = 0;
+int *num_sequences_pool_emp;
+static pthread_mutex_t minutes_lock = PTHREAD_MUTEX_INITIALIZER;   // Lazy end mask tables
+
+static inline int64_t saturated_add (int64_t a, int64_t b)
+{
+    return (a > SEQ_COUNT_MAX - b) ? SEQ_COUNT_MAX : a + b;
+}
+
+/* completions[r * num_shifts + s]: strings of r more shifts that can follow
+   shift s (s = 0 when nothing has been placed yet) */
+static inline int64_t completions (seq_length_index *idx, int r, int s)
+{
+    return idx->completions[r * idx->num_shifts + s];
+}
+
+static inline int can_follow (problem_instance *pi, seq_length_index *idx, int prev, int next)
+{
+    return idx->allowed[next] && (prev == 0 || !shifts_incompatible(pi, prev, next));
+}
+
+static int signature_max_length (problem_instance *pi, employee *e)
+{
+    int max_length = e->max_consecutive_shifts;
+    if (max_length > pi->horizon_length) max_length = pi->horizon_length;
+    if (max_length < 0) max_length = 0;
+    return max_length;
+}
+
+/* True if employee e has the contract signature (allowed shifts and maximum
+   length) the index was built for */
+static int same_signature (problem_instance *pi, seq_length_index *idx, employee *e)
+{
+    if (idx->max_length != signature_max_length(pi, e)) return 0;
+    for (int s = 1; s < pi->num_shifts; s++) {
+        if (idx->allowed[s] != (e->max_shifts[s] != 0)) return 0;
+    }
+    return 1;
+}
+
+static int gcd (int a, int b)
+{
+    while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/* Cumulative counts of strings of r more shifts after s that end with a shift
+   of end mask k, by minutes (in minute_unit) */
+static inline int64_t *minutes_row (seq_length_index *idx, int k, int r, int s)
+{
+    size_t row = (size_t)r * idx->num_shifts + s;
+    return &idx->by_minutes[k][row * (idx->max_units + 1)];
+}
+
+/* Strings counted in minutes_row(idx, k, r, s) with lo..hi units */
+static inline int64_t minutes_range (seq_length_index *idx, int k, int r, int s, int lo, int hi)
+{
+    if (hi > idx->max_units) hi = idx->max_units;
+    if (lo < 0) lo = 0;
+    if (lo > hi) return 0;
+    const int64_t *row = minutes_row(idx, k, r, s);
+    if (row[hi] == SEQ_COUNT_MAX) return SEQ_COUNT_MAX;
+    return (lo > 0) ? row[hi] - row[lo - 1] : row[hi];
+}
+
+/* Entries of the table of one end mask */
+static size_t minutes_table_entries (seq_length_index *idx)
+{
+    return (size_t)(idx->max_length + 1) * idx->num_shifts * (idx->max_units + 1);
+}
+
+/* Fills the table of end mask k: exact counts by minutes with the shifts that
+   may follow each one, then accumulated over the minutes */
+static void build_minutes_table (problem_instance *pi, seq_length_index *idx, int k)
+{
+    int ns = idx->num_shifts;
+    int L = idx->max_length;
+    int U = idx->max_units;
+    const char *end = &idx->end_masks[(size_t)k * ns];
+
+    int64_t *table = (int64_t *)malloc(minutes_table_entries(idx) * sizeof(int64_t));
+    int64_t *exact = (int64_t *)calloc(minutes_table_entries(idx), sizeof(int64_t));
+    if (!table || !exact) {
+        fprintf(stderr, "Memory allocation failed for sequence index.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int s = 0; s < ns; s++) {
+        exact[s * (U + 1)] = end[s] ? 1 : 0;
+    }
+    for (int r = 1; r <= L; r++) {
+        for (int s = 0; s < ns; s++) {
+            int64_t *e = &exact[((size_t)r * ns + s) * (U + 1)];
+            for (int f = 0; f < idx->num_follow[s]; f++) {
+                int t = idx->follow[s * ns + f];
+                int u = idx->units[t];
+                const int64_t *prev = &exact[((size_t)(r - 1) * ns + t) * (U + 1)];
+                for (int m = u; m <= U; m++) {
+                    if (prev[m - u] != 0) e[m] = saturated_add(e[m], prev[m - u]);
+                }
+            }
+        }
+    }
+    for (size_t row = 0; row < (size_t)(L + 1) * ns; row++) {
+        int64_t sum = 0;
+        for (int m = 0; m <= U; m++) {
+            sum = saturated_add(sum, exact[row * (U + 1) + m]);
+            table[row * (U + 1) + m] = sum;
+        }
+    }
+    free(exact);
+    idx->by_minutes[k] = table;
+}
+
+/* Builds the tables by minutes and end mask. A shift may end a sequence when
+   the shift worked the next day may follow it; next shifts with the same
+   incompatibilities share one end mask. Only the mask of a day off next is
+   built here (the roster search, which runs in parallel, uses that one); the
+   others are built the first time a query needs them */
+static void build_minutes_index (problem_instance *pi, seq_length_index *idx)
+{
+    int ns = idx->num_shifts;
+
+    int unit = 0, longest = 0;
+    for (int s = 1; s < ns; s++) {
+        if (!idx->allowed[s]) continue;
+        unit = gcd(unit, pi->shifts[s].length);
+        if (pi->shifts[s].length > longest) longest = pi->shifts[s].length;
+    }
+    idx->minute_unit = (unit > 0) ? unit : 1;
+    idx->max_units = idx->max_length * longest / idx->minute_unit;
+
+    idx->units = (int *)calloc(ns, sizeof(int));
+    idx->follow = (int *)malloc((size_t)ns * ns * sizeof(int));
+    idx->num_follow = (int *)calloc(ns, sizeof(int));
+    if (!idx->units || !idx->follow || !idx->num_follow) {
+        fprintf(stderr, "Memory allocation failed for sequence index.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int s = 0; s < ns; s++) {
+        if (idx->allowed[s]) idx->units[s] = pi->shifts[s].length / idx->minute_unit;
+        for (int t = 1; t < ns; t++) {
+            if (can_follow(pi, idx, s, t)) idx->follow[s * ns + idx->num_follow[s]++] = t;
+        }
+    }
+
+    idx->end_masks = (char *)calloc((size_t)ns * ns, sizeof(char));
+    idx->end_mask_of = (int *)malloc(ns * sizeof(int));
+    if (!idx->end_masks || !idx->end_mask_of) {
+        fprintf(stderr, "Memory allocation failed for sequence index.\n");
+        exit(EXIT_FAILURE);
+    }
+    idx->num_end_masks = 0;
+    for (int next = 0; next < ns; next++) {
+        char *m = &idx->end_masks[(size_t)idx->num_end_masks * ns];
+        for (int s = 1; s < ns; s++) {
+            m[s] = idx->allowed[s] && (next == 0 || !shifts_incompatible(pi, s, next));
+        }
+        int k = 0;
+        while (k < idx->num_end_masks && memcmp(&idx->end_masks[(size_t)k * ns], m, ns) != 0) k++;
+        if (k == idx->num_end_masks) idx->num_end_masks++;
+        idx->end_mask_of[next] = k;
+    }
+
+    idx->by_minutes = (int64_t **)calloc(idx->num_end_masks, sizeof(int64_t *));
+    if (!idx->by_minutes) {
+        fprintf(stderr, "Memory allocation failed for sequence index.\n");
+        exit(EXIT_FAILURE);
+    }
+    build_minutes_table(pi, idx, idx->end_mask_of[0]);
+}
+
+/* End mask of a query whose next day works next_shift, building its table if
+   it is still missing */
+static int query_end_mask (problem_instance *pi, seq_length_index *idx, int next_shift)
+{
+    int k = idx->end_mask_of[next_shift];
+    if (k == idx->end_mask_of[0]) return k;
+    pthread_mutex_lock(&minutes_lock);
+    if (idx->by_minutes[k] == NULL) build_minutes_table(pi, idx, k);
+    pthread_mutex_unlock(&minutes_lock);
+    return k;
+}
+
+/* Builds the counting tables of the contract of employee e */
+static void build_seq_index (problem_instance *pi, seq_length_index *idx, employee *e)
+{
+    int ns = pi->num_shifts;
+
+    idx->num_shifts = ns;
+    idx->max_length = signature_max_length(pi, e);
+
+    idx->allowed = (char *)calloc(ns, sizeof(char));
+    idx->completions = (int64_t *)malloc((size_t)(idx->max_length + 1) * ns * sizeof(int64_t));
+    idx->count_by_length = (int64_t *)calloc(idx->max_length + 1, sizeof(int64_t));
+    if (!idx->allowed || !idx->completions || !idx->count_by_length) {
+        fprintf(stderr, "Memory allocation failed for sequence index.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int s = 1; s < ns; s++) {
+        idx->allowed[s] = (e->max_shifts[s] != 0);
+    }
+
+    for (int s = 0; s < ns; s++) {
+        idx->completions[s] = 1;
+    }
+    for (int r = 1; r <= idx->max_length; r++) {
+        for (int s = 0; s < ns; s++) {
+            int64_t total = 0;
+            for (int t = 1; t < ns; t++) {
+                if (can_follow(pi, idx, s, t)) total = saturated_add(total, completions(idx, r - 1, t));
+            }
+            idx->completions[r * ns + s] = total;
+        }
+    }
+
+    idx->total = 0;
+    for (int len = 1; len <= idx->max_length; len++) {
+        idx->count_by_length[len] = completions(idx, len, 0);
+        idx->total = saturated_add(idx->total, idx->count_by_length[len]);
+    }
+
+    build_minutes_index(pi, idx);
+}
+
+/* Builds one index per distinct contract signature and points every employee
+   at the index of its class */
+void build_seq_indexes (problem_instance *pi)
+{
+    int num_emps = pi->num_employees;
+
+    seq_classes = (seq_length_index *)malloc(num_emps * sizeof(seq_length_index));
+    seq_index = (seq_length_index **)malloc(num_emps * sizeof(seq_length_index *));
+    if (!seq_classes || !seq_index) {
+        fprintf(stderr, "Memory allocation failed for sequence index.\n");
+        exit(EXIT_FAILURE);
+    }
+    num_seq_classes = 0;
+    for (int emp = 0; emp < num_emps; emp++) {
+        employee *e = &pi->employees[emp];
+        int c = 0;
+        while (c < num_seq_classes && !same_signature(pi, &seq_classes[c], e)) c++;
+        if (c == num_seq_classes) {
+            build_seq_index(pi, &seq_classes[c], e);
+            num_seq_classes++;
+        }
+        seq_index[emp] = &seq_classes[c];
+    }
+}
+
+/* Empties the index (no sequences of any length) */
+void clear_seq_index (seq_length_index *idx)
+{
+    for (int len = 0; len <= idx->max_length; len++) idx->count_by_length[len] = 0;
+    for (int k = 0; k < idx->num_end_masks; k++) {
+        if (idx->by_minutes[k] != NULL) memset(idx->by_minutes[k], 0, minutes_table_entries(idx) * sizeof(int64_t));
+    }
+    idx->total = 0;
+}
+
+/* Bytes used by the counting tables of every contract class */
+size_t seq_indexes_bytes (void)
+{
+    size_t bytes = 0;
+    for (int c = 0; c < num_seq_classes; c++) {
+        seq_length_index *idx = &seq_classes[c];
+        bytes += (size_t)(idx->max_length + 1) * idx->num_shifts * sizeof(int64_t);
+        for (int k = 0; k < idx->num_end_masks; k++) {
+            if (idx->by_minutes[k] != NULL) bytes += minutes_table_entries(idx) * sizeof(int64_t);
+        }
+    }
+    return bytes;
+}
+
+void free_seq_indexes (void)
+{
+    for (int c = 0; c < num_seq_classes; c++) {
+        free(seq_classes[c].allowed);
+        free(seq_classes[c].completions);
+        free(seq_classes[c].count_by_length);
+        for (int k = 0; k < seq_classes[c].num_end_masks; k++) free(seq_classes[c].by_minutes[k]);
+        free(seq_classes[c].by_minutes);
+        free(seq_classes[c].end_masks);
+        free(seq_classes[c].end_mask_of);
+        free(seq_classes[c].units);
+        free(seq_classes[c].follow);
+        free(seq_classes[c].num_follow);
+    }
+    free(seq_classes);
+    free(seq_index);
+    seq_classes = NULL;
+    seq_index = NULL;
+    num_seq_classes = 0;
+}
+
+/* Id in table t of the sequence of employee emp with the given length and
+   lexicographic rank (0 <= rank < count_by_length[length]), interned on first use */
+seq_id seq_unrank (sequence_table *t, problem_instance *pi, int emp, int length, int64_t rank)
+{
+    seq_length_index *idx = seq_index[emp];
+    int shifts[length];
+    int prev = 0;
+
+    for (int pos = 0; pos < length; pos++) {
+        int r = length - pos - 1;
+        int chosen = -1;
+        for (int t = 1; t < idx->num_shifts; t++) {
+            if (!can_follow(pi, idx, prev, t)) continue;
+            int64_t c = completions(idx, r, t);
+            if (rank < c) {
+                chosen = t;
+                break;
+            }
+            rank -= c;
+        }
+        if (chosen < 0) {
+            fprintf(stderr, "Error: sequence rank out of range for employee %d, length %d.\n", emp, length);
+            exit(EXIT_FAILURE);
+        }
+        shifts[pos] = chosen;
+        prev = chosen;
+    }
+    return seq_table_intern(t, pi, shifts, length);
+}
+
+/* Uniform rank among the sequences of the given length (which must exist),
+   drawn from stream rs */
+int64_t seq_random_rank (seq_length_index *idx, int length, rand_stream *rs)
+{
+    return seq_random_below(idx->count_by_length[length], rs);
+}
+
+/* Uniform integer in [0, count), count > 0, drawn from stream rs */
+int64_t seq_random_below (int64_t count, rand_stream *rs)
+{
+    if (count <= INT32_MAX) {
+        return stream_rnd(rs, 0, (int)(count - 1));
+    }
+    int64_t r = (int64_t)(stream_randomperc(rs) * (double)count);
+    return (r < count) ? r : count - 1;
+}
+
+/* Range of minutes of query q in units of idx */
+static void query_units (seq_length_index *idx, const seq_query *q, int *lo, int *hi)
+{
+    int unit = idx->minute_unit;
+    *lo = (q->min_minutes > 0) ? (q->min_minutes + unit - 1) / unit : 0;
+    *hi = (q->max_minutes >= 0) ? q->max_minutes / unit : -1;
+}
+
+/* Number of sequences of the index that match query q */
+int64_t seq_query_count (problem_instance *pi, seq_length_index *idx, const seq_query *q)
+{
+    int lo, hi;
+    if (q->length < 1 || q->length > idx->max_length) return 0;
+    query_units(idx, q, &lo, &hi);
+    return minutes_range(idx, query_end_mask(pi, idx, q->next_shift), q->length, q->prev_shift, lo, hi);
+}
+
+/* Id in table t of the sequence of rank rank (in lexicographic order) among
+   those of employee emp that match query q, interned on first use */
+seq_id seq_query_unrank (sequence_table *t, problem_instance *pi, int emp, const seq_query *q, int64_t rank)
+{
+    seq_length_index *idx = seq_index[emp];
+    int k = query_end_mask(pi, idx, q->next_shift);
+    int length = q->length;
+    int shifts[length];
+    int prev = q->prev_shift;
+    int lo, hi;
+
+    query_units(idx, q, &lo, &hi);
+    for (int pos = 0; pos < length; pos++) {
+        int r = length - pos - 1;
+        int chosen = -1;
+        const int *follow = &idx->follow[prev * idx->num_shifts];
+        for (int f = 0; f < idx->num_follow[prev]; f++) {
+            int s = follow[f];
+            int u = idx->units[s];
+            int64_t c = minutes_range(idx, k, r, s, lo - u, hi - u);
+            if (rank < c) {
+                chosen = s;
+                lo -= u;
+                hi -= u;
+                break;
+            }
+            rank -= c;
+        }
+        if (chosen < 0) {
+            fprintf(stderr, "Error: sequence rank out of range for employee %d, length %d.\n", emp, length);
+            exit(EXIT_FAILURE);
+        }
+        shifts[pos] = chosen;
+        prev = chosen;
+    }
+    return seq_table_intern(t, pi, shifts, length);
+}
@@ -0,0 +1,151 @@
+/* Table of interned work sequences (see sequence_table in global.h). Besides the
+   global seq_table, the roster search of initialize.c interns into a private
+   table per employee so that employees can be processed in parallel */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# include "global.h"
+
+sequence_table seq_table;
+
+/* FNV-1a steps shared by content_hash and packed_hash, so that a sequence hashes
+   the same whether it comes as ints or packed in the table */
+static inline uint64_t hash_start (int length)
+{
+    return 0xcbf29ce484222325ULL ^ (uint64_t)length;
+}
+
+static inline uint64_t hash_step (uint64_t h, int shift_id)
+{
+    return (h ^ (uint64_t)shift_id) * 0x100000001b3ULL;
+}
+
+static inline uint64_t hash_finish (uint64_t h)
+{
+    return h ^ (h >> 29);
+}
+
+static uint64_t content_hash (const int *shifts, int length)
+{
+    uint64_t h = hash_start(length);
+    for (int i = 0; i < length; i++) h = hash_step(h, shifts[i]);
+    return hash_finish(h);
+}
+
+/* Same hash as content_hash, over a sequence already in the table */
+static uint64_t packed_hash (sequence_table *t, seq_id id)
+{
+    const uint8_t *shifts = seq_shifts_in(t, id);
+    int length = seq_length_in(t, id);
+    uint64_t h = hash_start(length);
+    for (int i = 0; i < length; i++) h = hash_step(h, shifts[i]);
+    return hash_finish(h);
+}
+
+static void *grow (void *ptr, size_t bytes)
+{
+    void *p = realloc(ptr, bytes);
+    if (p == NULL) {
+        fprintf(stderr, "Memory allocation failed for sequence table.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* Rebuilds the content hash with room for twice the current capacity */
+static void rehash (sequence_table *t)
+{
+    int size = 16;
+    while (size < 2 * t->capacity) size *= 2;
+    t->hash_mask = size - 1;
+    t->hash_slots = (int *)grow(t->hash_slots, size * sizeof(int));
+    for (int i = 0; i < size; i++) t->hash_slots[i] = -1;
+
+    for (int id = 0; id < t->count; id++) {
+        int slot = (int)(packed_hash(t, id) & t->hash_mask);
+        while (t->hash_slots[slot] >= 0) slot = (slot + 1) & t->hash_mask;
+        t->hash_slots[slot] = id;
+    }
+}
+
+static int same_content (sequence_table *t, seq_id id, const int *shifts, int length)
+{
+    if (seq_length_in(t, id) != length) return 0;
+    const uint8_t *packed = seq_shifts_in(t, id);
+    for (int i = 0; i < length; i++) {
+        if (packed[i] != shifts[i]) return 0;
+    }
+    return 1;
+}
+
+/* Returns the id of the sequence shifts[0..length), adding it to the table
+   (with its summary) the first time it is seen. t starts zeroed */
+seq_id seq_table_intern (sequence_table *t, problem_instance *pi, const int *shifts, int length)
+{
+    if (length <= 0) {
+        fprintf(stderr, "Error: empty sequence interned.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (t->capacity == 0) {
+        t->num_shifts = pi->num_shifts;
+        t->offset = (int *)grow(NULL, sizeof(int));
+        t->offset[0] = 0;
+        t->count = 0;
+    }
+    if (t->count >= t->capacity) {
+        t->capacity = (t->capacity == 0) ? 256 : 2 * t->capacity;
+        t->offset = (int *)grow(t->offset, (t->capacity + 1) * sizeof(int));
+        t->shift_counts = (int *)grow(t->shift_counts,
+                                             (size_t)t->capacity * t->num_shifts * sizeof(int));
+        t->internal_incompat = (int *)grow(t->internal_incompat, t->capacity * sizeof(int));
+        rehash(t);
+    }
+
+    uint64_t h = content_hash(shifts, length);
+    int slot = (int)(h & t->hash_mask);
+    while (t->hash_slots[slot] >= 0) {
+        if (same_content(t, t->hash_slots[slot], shifts, length)) return t->hash_slots[slot];
+        slot = (slot + 1) & t->hash_mask;
+    }
+
+    int start = t->offset[t->count];
+    if (start + length > t->shifts_capacity) {
+        while (start + length > t->shifts_capacity) {
+            t->shifts_capacity = (t->shifts_capacity == 0) ? 1024 : 2 * t->shifts_capacity;
+        }
+        t->shifts = (uint8_t *)grow(t->shifts, t->shifts_capacity * sizeof(uint8_t));
+        t->minutes_prefix = (int *)grow(t->minutes_prefix, t->shifts_capacity * sizeof(int));
+    }
+
+    seq_id id = t->count;
+    int *counts = &t->shift_counts[(size_t)id * t->num_shifts];
+    memset(counts, 0, t->num_shifts * sizeof(int));
+    int minutes = 0;
+    int incompat = 0;
+    for (int i = 0; i < length; i++) {
+        int s = shifts[i];
+        t->shifts[start + i] = (uint8_t)s;
+        counts[s]++;
+        minutes += pi->shifts[s].length;
+        t->minutes_prefix[start + i] = minutes;
+        if (i > 0 && shifts_incompatible(pi, shifts[i - 1], s)) incompat++;
+    }
+    t->internal_incompat[id] = incompat;
+    t->offset[id + 1] = start + length;
+    t->hash_slots[slot] = id;
+    t->count++;
+    return id;
+}
+
+void seq_table_free (sequence_table *t)
+{
+    free(t->offset);
+    free(t->shifts);
+    free(t->minutes_prefix);
+    free(t->shift_counts);
+    free(t->internal_incompat);
+    free(t->hash_slots);
+    memset(t, 0, sizeof(*t));
+}
@@ -0,0 +1,146 @@
+/* Fixed-size worker pool used to process independent population members in parallel */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <pthread.h>
+
+# include "global.h"
+
+int num_threads = 1;
+eval_context **thread_eval_ctx = NULL; // One evaluation context per thread (0 = caller)
+
+static pthread_t *workers = NULL;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+static void (*job_fn)(int index, int thread_id, void *arg);
+static void *job_arg;
+static int job_size;
+static int job_next;       // Next index to hand out
+static int job_pending;    // Workers still running the current job
+static int job_generation; // Incremented each time a job is posted
+static int pool_shutdown;
+
+/* Hands out indices of the current job until none are left */
+static void run_job_items(int thread_id)
+{
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        int index = job_next++;
+        pthread_mutex_unlock(&pool_lock);
+        if (index >= job_size) break;
+        job_fn(index, thread_id, job_arg);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    int thread_id = (int)(long)arg;
+    int seen_generation = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (!pool_shutdown && job_generation == seen_generation) {
+            pthread_cond_wait(&work_cond, &pool_lock);
+        }
+        if (pool_shutdown) {
+            pthread_mutex_unlock(&pool_lock);
+            break;
+        }
+        seen_generation = job_generation;
+        pthread_mutex_unlock(&pool_lock);
+
+        run_job_items(thread_id);
+
+        pthread_mutex_lock(&pool_lock);
+        if (--job_pending == 0) {
+            pthread_cond_signal(&done_cond);
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return NULL;
+}
+
+/* Starts nthreads-1 workers (the calling thread is thread 0) and one
+   evaluation context per thread. Must be called after the instance is read */
+void threadpool_init(int nthreads, problem_instance *pi)
+{
+    if (nthreads < 1) nthreads = 1;
+    num_threads = nthreads;
+
+    thread_eval_ctx = (eval_context **)malloc(num_threads * sizeof(eval_context *));
+    if (thread_eval_ctx == NULL) {
+        fprintf(stderr, "Memory allocation failed for thread contexts.\n");
+        exit(EXIT_FAILURE);
+    }
+    thread_eval_ctx[0] = default_eval_ctx;
+    for (int t = 1; t < num_threads; t++) {
+        thread_eval_ctx[t] = allocate_eval_context(pi);
+    }
+
+    if (num_threads == 1) return;
+    workers = (pthread_t *)malloc((num_threads - 1) * sizeof(pthread_t));
+    if (workers == NULL) {
+        fprintf(stderr, "Memory allocation failed for worker threads.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&workers[t - 1], NULL, worker_main, (void *)(long)t) != 0) {
+            fprintf(stderr, "Error: could not create worker thread %d.\n", t);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* Stops the workers and frees their contexts (not the default one) */
+void threadpool_destroy(void)
+{
+    if (workers != NULL) {
+        pthread_mutex_lock(&pool_lock);
+        pool_shutdown = 1;
+        pthread_cond_broadcast(&work_cond);
+        pthread_mutex_unlock(&pool_lock);
+        for (int t = 1; t < num_threads; t++) {
+            pthread_join(workers[t - 1], NULL);
+        }
+        free(workers);
+        workers = NULL;
+    }
+    if (thread_eval_ctx != NULL) {
+        for (int t = 1; t < num_threads; t++) {
+            deallocate_eval_context(thread_eval_ctx[t]);
+        }
+        free(thread_eval_ctx);
+        thread_eval_ctx = NULL;
+    }
+    num_threads = 1;
+}
+
+/* Calls fn(i, thread_id, arg) for i in [0, n) and returns when all calls are done.
+   Calls for different i may run concurrently, so fn must only write data owned by i */
+void parallel_for(int n, void (*fn)(int index, int thread_id, void *arg), void *arg)
+{
+    if (num_threads == 1 || n <= 1) {
+        for (int i = 0; i < n; i++) fn(i, 0, arg);
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    job_fn = fn;
+    job_arg = arg;
+    job_size = n;
+    job_next = 0;
+    job_pending = num_threads - 1;
+    job_generation++;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&pool_lock);
+
+    run_job_items(0);
+
+    pthread_mutex_lock(&pool_lock);
+    while (job_pending > 0) {
+        pthread_cond_wait(&done_cond, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}